@@ -0,0 +1,154 @@
+// Times ParallelFor and ParallelReduce with 1 to N workers to show how the work stealing scales. Built on its own,
+// outside the sandbox unity build, e.g.
+//
+//   clang++ -std=c++20 -O2 -ISource Source/Bench/BkJobsBench.cpp -o BkJobsBench -pthread
+//   ./BkJobsBench [maxWorkers]
+
+#include "../BkCore/BkArena.cpp"
+#include "../BkCore/BkCore.cpp"
+#include "../BkCore/BkFile.cpp"
+#include "../BkCore/BkJobs.cpp"
+#include "../BkCore/BkMemory.cpp"
+#include "../BkCore/BkString.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace Bk;
+
+constexpr size_t BenchItemCount = 1 << 23;
+constexpr size_t BenchBlockSize = BK_KILOBYTES(4);
+constexpr uint32 BenchRepeatCount = 5;
+
+struct BenchResult
+{
+	double transformMs;
+	double hashMs;
+	uint64 check;
+};
+
+// An uneven transform, later items cost more, so fixed chunking would leave workers idle
+static void TransformItems(TSpan<float> items, Arena& scratch)
+{
+	for (size_t itemIdx = 0; itemIdx < items.length; ++itemIdx)
+	{
+		float value = items.data[itemIdx];
+		uint32 steps = 4 + static_cast<uint32>(value) % 16;
+
+		for (uint32 stepIdx = 0; stepIdx < steps; ++stepIdx)
+		{
+			value = value * 0.999f + 0.5f;
+		}
+
+		items.data[itemIdx] = value;
+	}
+}
+
+static BenchResult RunBench(TSpan<float> items, TSpan<uint8> bytes)
+{
+	BenchResult result = {};
+	result.transformMs = 1e30;
+	result.hashMs = 1e30;
+
+	static uint8* blockStorage[BenchItemCount * sizeof(float) / BenchBlockSize];
+	TSpan<uint8*> blocks(blockStorage, bytes.length / BenchBlockSize);
+
+	for (size_t blockIdx = 0; blockIdx < blocks.length; ++blockIdx)
+	{
+		blocks.data[blockIdx] = bytes.data + blockIdx * BenchBlockSize;
+	}
+
+	for (uint32 repeatIdx = 0; repeatIdx < BenchRepeatCount; ++repeatIdx)
+	{
+		double start = GetTimeSec();
+		ParallelFor(items, 1024, TransformItems);
+		result.transformMs = BK_MIN(result.transformMs, (GetTimeSec() - start) * 1000);
+
+		start = GetTimeSec();
+		result.check = ParallelReduce(
+			blocks, 16, uint64(0),
+			[](TSpan<uint8*> range, Arena& scratch)
+			{
+				uint64 hash = 0;
+				for (size_t blockIdx = 0; blockIdx < range.length; ++blockIdx)
+				{
+					hash ^= MemoryHash(range.data[blockIdx], BenchBlockSize);
+				}
+				return hash;
+			},
+			[](uint64 left, uint64 right) { return left ^ right; });
+		result.hashMs = BK_MIN(result.hashMs, (GetTimeSec() - start) * 1000);
+	}
+
+	return result;
+}
+
+static void PrintResult(uint32 workerCount, const BenchResult& result, const BenchResult& baseline)
+{
+	printf("%8u %14.2f %8.2fx %14.2f %8.2fx\n", workerCount, result.transformMs, baseline.transformMs / result.transformMs,
+		result.hashMs, baseline.hashMs / result.hashMs);
+}
+
+int main(int argc, char** argv)
+{
+	Arena arena = {};
+
+	uint32 maxWorkers = argc > 1 ? static_cast<uint32>(atoi(argv[1])) : 0;
+	if (maxWorkers == 0)
+	{
+		JobsInitialize(&arena);
+		maxWorkers = GetJobWorkerCount();
+		JobsShutdown();
+		arena.SetMarker({});
+	}
+
+	float* itemData = static_cast<float*>(MemoryAllocate(BenchItemCount * sizeof(float)));
+	TSpan<float> items(itemData, BenchItemCount);
+	TSpan<uint8> bytes(reinterpret_cast<uint8*>(itemData), BenchItemCount * sizeof(float));
+
+	printf("%8s %14s %9s %14s %9s\n", "Workers", "ParallelFor ms", "Speedup", "Reduce ms", "Speedup");
+
+	BenchResult baseline = {};
+	uint64 check = 0;
+
+	for (uint32 workerCount = 1;; workerCount = BK_MIN(workerCount * 2, maxWorkers))
+	{
+		for (size_t itemIdx = 0; itemIdx < BenchItemCount; ++itemIdx)
+		{
+			items.data[itemIdx] = static_cast<float>(itemIdx % 4096);
+		}
+
+		if (!JobsInitialize(&arena, workerCount))
+		{
+			printf("Failed to start %u workers\n", workerCount);
+			return 1;
+		}
+
+		BenchResult result = RunBench(items, bytes);
+
+		JobsShutdown();
+		arena.SetMarker({});
+
+		if (workerCount == 1)
+		{
+			baseline = result;
+			check = result.check;
+		}
+		else if (result.check != check)
+		{
+			printf("Reduce result differs with %u workers\n", workerCount);
+			return 1;
+		}
+
+		PrintResult(workerCount, result, baseline);
+
+		if (workerCount == maxWorkers)
+		{
+			break;
+		}
+	}
+
+	MemoryDeallocate(itemData, BenchItemCount * sizeof(float));
+
+	return 0;
+}
@@ -0,0 +1,204 @@
+// Compares MemoryAllocate with the C runtime's malloc on a few allocation patterns, with 1 to N threads. Built on its
+// own, outside the sandbox unity build, e.g.
+//
+//   clang++ -std=c++20 -O2 -DBK_SIZE_CLASS_ALLOCATOR -ISource Source/Bench/BkMemoryBench.cpp -o BkMemoryBench -pthread
+//   ./BkMemoryBench [maxThreads]
+
+#include "../BkCore/BkArena.cpp"
+#include "../BkCore/BkCore.cpp"
+#include "../BkCore/BkMemory.cpp"
+#include "../BkCore/BkString.cpp"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace Bk;
+
+constexpr uint32 BenchLiveCount = 4096;
+constexpr uint32 BenchChurnCount = 1 << 21;
+constexpr uint32 BenchHandoffRounds = 256;
+constexpr uint32 BenchMaxThreads = 64;
+
+struct BenchAllocator
+{
+	const char* name;
+	void* (*allocate)(size_t size);
+	void (*deallocate)(void* ptr, size_t size);
+};
+
+struct BenchThread
+{
+	pthread_t thread;
+	const BenchAllocator* allocator;
+	uint32 threadIdx;
+	uint32 threadCount;
+	void** ptrs;
+	size_t* sizes;
+};
+
+static pthread_barrier_t benchBarrier;
+static BenchThread benchThreads[BenchMaxThreads];
+
+static void* BenchMalloc(size_t size)
+{
+	return malloc(size);
+}
+
+static void BenchFree(void* ptr, size_t size)
+{
+	free(ptr);
+}
+
+static void* BenchMemoryAllocate(size_t size)
+{
+	return MemoryAllocate(size);
+}
+
+static uint32 BenchRandom(uint32& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+// Mostly small sizes with a tail up to 4 KB, the rough shape of what the engine allocates
+static size_t BenchSize(uint32& random)
+{
+	uint32 value = BenchRandom(random);
+	return (value & 7) != 0 ? 16 + (value >> 8) % 240 : 256 + (value >> 8) % 3840;
+}
+
+// Replaces random members of a live set, every thread on its own
+static void* RunChurn(void* data)
+{
+	BenchThread& bench = *static_cast<BenchThread*>(data);
+	const BenchAllocator& allocator = *bench.allocator;
+	uint32 random = 0x9E3779B9u * (bench.threadIdx + 1);
+
+	for (uint32 slotIdx = 0; slotIdx < BenchLiveCount; ++slotIdx)
+	{
+		bench.sizes[slotIdx] = BenchSize(random);
+		bench.ptrs[slotIdx] = allocator.allocate(bench.sizes[slotIdx]);
+	}
+
+	for (uint32 churnIdx = 0; churnIdx < BenchChurnCount / bench.threadCount; ++churnIdx)
+	{
+		uint32 slotIdx = BenchRandom(random) % BenchLiveCount;
+		allocator.deallocate(bench.ptrs[slotIdx], bench.sizes[slotIdx]);
+
+		bench.sizes[slotIdx] = BenchSize(random);
+		bench.ptrs[slotIdx] = allocator.allocate(bench.sizes[slotIdx]);
+		static_cast<uint8*>(bench.ptrs[slotIdx])[0] = 1;
+	}
+
+	for (uint32 slotIdx = 0; slotIdx < BenchLiveCount; ++slotIdx)
+	{
+		allocator.deallocate(bench.ptrs[slotIdx], bench.sizes[slotIdx]);
+	}
+
+	return nullptr;
+}
+
+// Every thread allocates a batch, then frees the batch of its neighbour, so all frees come from another thread
+static void* RunHandoff(void* data)
+{
+	BenchThread& bench = *static_cast<BenchThread*>(data);
+	const BenchAllocator& allocator = *bench.allocator;
+	BenchThread& neighbour = benchThreads[(bench.threadIdx + 1) % bench.threadCount];
+	uint32 random = 0x9E3779B9u * (bench.threadIdx + 1);
+
+	for (uint32 roundIdx = 0; roundIdx < BenchHandoffRounds / bench.threadCount + 1; ++roundIdx)
+	{
+		for (uint32 slotIdx = 0; slotIdx < BenchLiveCount; ++slotIdx)
+		{
+			bench.sizes[slotIdx] = BenchSize(random);
+			bench.ptrs[slotIdx] = allocator.allocate(bench.sizes[slotIdx]);
+		}
+
+		pthread_barrier_wait(&benchBarrier);
+
+		for (uint32 slotIdx = 0; slotIdx < BenchLiveCount; ++slotIdx)
+		{
+			allocator.deallocate(neighbour.ptrs[slotIdx], neighbour.sizes[slotIdx]);
+		}
+
+		pthread_barrier_wait(&benchBarrier);
+	}
+
+	return nullptr;
+}
+
+static double RunBench(void* (*function)(void*), const BenchAllocator& allocator, uint32 threadCount)
+{
+	pthread_barrier_init(&benchBarrier, nullptr, threadCount);
+
+	double start = GetTimeSec();
+
+	for (uint32 threadIdx = 0; threadIdx < threadCount; ++threadIdx)
+	{
+		BenchThread& bench = benchThreads[threadIdx];
+		bench.allocator = &allocator;
+		bench.threadIdx = threadIdx;
+		bench.threadCount = threadCount;
+		pthread_create(&bench.thread, nullptr, function, &bench);
+	}
+
+	for (uint32 threadIdx = 0; threadIdx < threadCount; ++threadIdx)
+	{
+		pthread_join(benchThreads[threadIdx].thread, nullptr);
+	}
+
+	double seconds = GetTimeSec() - start;
+	pthread_barrier_destroy(&benchBarrier);
+
+	return seconds;
+}
+
+int main(int argc, char** argv)
+{
+	uint32 maxThreads = argc > 1 ? static_cast<uint32>(atoi(argv[1])) : static_cast<uint32>(sysconf(_SC_NPROCESSORS_ONLN));
+	maxThreads = BK_CLAMP(maxThreads, 1u, BenchMaxThreads);
+
+	for (uint32 threadIdx = 0; threadIdx < maxThreads; ++threadIdx)
+	{
+		benchThreads[threadIdx].ptrs = static_cast<void**>(malloc(sizeof(void*) * BenchLiveCount));
+		benchThreads[threadIdx].sizes = static_cast<size_t*>(malloc(sizeof(size_t) * BenchLiveCount));
+	}
+
+	BenchAllocator allocators[] = {
+		{"malloc", BenchMalloc, BenchFree},
+		{"MemoryAllocate", BenchMemoryAllocate, MemoryDeallocate},
+	};
+
+#if !defined(BK_SIZE_CLASS_ALLOCATOR)
+	printf("Built without BK_SIZE_CLASS_ALLOCATOR, MemoryAllocate forwards to malloc\n");
+#endif
+
+	printf("%-8s %-16s %8s %12s\n", "Pattern", "Allocator", "Threads", "ns per op");
+
+	for (uint32 threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+	{
+		for (const BenchAllocator& allocator : allocators)
+		{
+			double seconds = RunBench(RunChurn, allocator, threadCount);
+			double operations = 2.0 * (BenchChurnCount / threadCount) * threadCount;
+			printf("%-8s %-16s %8u %12.1f\n", "Churn", allocator.name, threadCount, seconds * 1e9 / operations);
+		}
+
+		for (const BenchAllocator& allocator : allocators)
+		{
+			double seconds = RunBench(RunHandoff, allocator, threadCount);
+			double operations = 2.0 * BenchLiveCount * (BenchHandoffRounds / threadCount + 1) * threadCount;
+			printf("%-8s %-16s %8u %12.1f\n", "Handoff", allocator.name, threadCount, seconds * 1e9 / operations);
+		}
+
+		if (threadCount < maxThreads && threadCount * 2 > maxThreads)
+		{
+			threadCount = maxThreads / 2;
+		}
+	}
+
+	return 0;
+}
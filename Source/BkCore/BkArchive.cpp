@@ -0,0 +1,295 @@
+#include "BkArchive.h"
+
+#include "BkArena.h"
+#include "BkCompression.h"
+#include "BkMemory.h"
+
+namespace Bk
+{
+	// Computed in 64 bits so counts read from a file can't wrap it on 32 bit targets
+	static uint64 GetArchiveTocSize(uint32 entryCount, uint32 slotCount, uint64 namesSize)
+	{
+		return uint64(entryCount) * sizeof(ArchiveEntry) + uint64(slotCount) * sizeof(uint32) + namesSize;
+	}
+
+	bool ArchiveBuilder::Begin(Arena* builderArena, const char* path, uint32 entryCapacity, uint32 blobAlignment)
+	{
+		BK_ASSERT(blobAlignment > 0 && (blobAlignment & (blobAlignment - 1)) == 0);
+
+		arena = builderArena;
+		entries = arena->PushZeroed<ArchiveEntry>(entryCapacity);
+		names = arena->PushZeroed<const char*>(entryCapacity);
+		entryCount = 0;
+		maxEntries = entryCapacity;
+		alignment = BK_MAX(blobAlignment, uint32(alignof(ArchiveEntry)));
+		offset = AlignUp(uint64(sizeof(ArchiveHeader)), alignment);
+		namesSize = 0;
+		failed = false;
+
+		handle = OpenFile(path, FileAccess::Write);
+		return handle != 0;
+	}
+
+	bool ArchiveBuilder::Add(String name, TSpan<uint8> data, bool compress)
+	{
+		if (failed || entryCount == maxEntries)
+		{
+			failed = true;
+			return false;
+		}
+
+		ArenaMarker marker = arena->GetMarker();
+
+		TSpan<uint8> storedData = data;
+		ArchiveCompression compression = ArchiveCompression::None;
+
+		if (compress && data.length > 0)
+		{
+			TSpan<uint8> compressed(arena->Push(data.length - 1), data.length - 1);
+			compressed.length = CompressBlock(data, compressed);
+
+			if (compressed.length > 0)
+			{
+				storedData = compressed;
+				compression = ArchiveCompression::Block;
+			}
+		}
+
+		bool written = WriteFileAt(handle, offset, storedData) == storedData.length;
+		arena->SetMarker(marker);
+
+		if (!written)
+		{
+			failed = true;
+			return false;
+		}
+
+		char* nameData = reinterpret_cast<char*>(arena->Push(name.length, 1));
+		MemoryCopy(nameData, name.data, name.length);
+
+		ArchiveEntry& entry = entries[entryCount];
+		entry.nameHash = MemoryHash(name.data, name.length);
+		entry.offset = offset;
+		entry.storedSize = storedData.length;
+		entry.size = data.length;
+		entry.nameOffset = static_cast<uint32>(namesSize);
+		entry.nameLength = static_cast<uint32>(name.length);
+		entry.compression = compression;
+
+		names[entryCount] = nameData;
+		entryCount += 1;
+
+		offset = AlignUp(offset + storedData.length, alignment);
+		namesSize += name.length;
+
+		return true;
+	}
+
+	bool ArchiveBuilder::Finish()
+	{
+		if (failed || namesSize > UINT32_MAX)
+		{
+			CloseFile(handle);
+			return false;
+		}
+
+		uint32 slotCount = 16;
+		while (slotCount < entryCount * 2)
+		{
+			slotCount *= 2;
+		}
+
+		ArenaMarker marker = arena->GetMarker();
+
+		size_t tocSize = size_t(GetArchiveTocSize(entryCount, slotCount, namesSize));
+		uint8* toc = arena->PushZeroed(tocSize, alignof(ArchiveEntry));
+
+		ArchiveEntry* tocEntries = reinterpret_cast<ArchiveEntry*>(toc);
+		uint32* slots = reinterpret_cast<uint32*>(tocEntries + entryCount);
+		char* tocNames = reinterpret_cast<char*>(slots + slotCount);
+
+		bool result = true;
+
+		for (uint32 entryIdx = 0; entryIdx < entryCount && result; ++entryIdx)
+		{
+			const ArchiveEntry& entry = entries[entryIdx];
+
+			tocEntries[entryIdx] = entry;
+			MemoryCopy(tocNames + entry.nameOffset, names[entryIdx], entry.nameLength);
+
+			// Linear probing, the table is at most half full
+			uint32 slotMask = slotCount - 1;
+			for (uint32 slotIdx = uint32(entry.nameHash) & slotMask;; slotIdx = (slotIdx + 1) & slotMask)
+			{
+				if (slots[slotIdx] == 0)
+				{
+					slots[slotIdx] = entryIdx + 1;
+					break;
+				}
+
+				const ArchiveEntry& other = entries[slots[slotIdx] - 1];
+				if (other.nameHash == entry.nameHash && other.nameLength == entry.nameLength &&
+					MemoryCompare(names[slots[slotIdx] - 1], names[entryIdx], entry.nameLength) == 0)
+				{
+					// Duplicate names can't be looked up
+					result = false;
+					break;
+				}
+			}
+		}
+
+		ArchiveHeader header = {};
+		header.magic = ArchiveHeader::Magic;
+		header.version = ArchiveHeader::Version;
+		header.size = offset + tocSize;
+		header.tocOffset = offset;
+		header.entryCount = entryCount;
+		header.slotCount = slotCount;
+		header.namesSize = static_cast<uint32>(namesSize);
+		header.alignment = alignment;
+
+		// Header goes last, so an archive that failed halfway never looks valid. Opening for writing truncated the
+		// file, so it ends with the table of contents
+		result = result && WriteFileAt(handle, offset, TSpan(toc, tocSize)) == tocSize;
+		result = result && WriteFileAt(handle, 0, TSpan(reinterpret_cast<uint8*>(&header), sizeof(header))) == sizeof(header);
+
+		arena->SetMarker(marker);
+		CloseFile(handle);
+
+		return result;
+	}
+
+	bool Archive::Open(const char* path)
+	{
+		*this = {};
+
+		FileHandle handle = OpenFile(path, FileAccess::Read);
+		TSpan<uint8> data = MapFile(handle, FileMapFlags::Random);
+		CloseFile(handle);
+
+		if (data.length < sizeof(ArchiveHeader))
+		{
+			UnmapFile(data);
+			return false;
+		}
+
+		const ArchiveHeader* archiveHeader = reinterpret_cast<const ArchiveHeader*>(data.data);
+
+		bool valid = archiveHeader->magic == ArchiveHeader::Magic && archiveHeader->version == ArchiveHeader::Version &&
+			archiveHeader->size == data.length && archiveHeader->slotCount > 0 &&
+			(archiveHeader->slotCount & (archiveHeader->slotCount - 1)) == 0 &&
+			archiveHeader->tocOffset % alignof(ArchiveEntry) == 0 && archiveHeader->tocOffset <= data.length &&
+			GetArchiveTocSize(archiveHeader->entryCount, archiveHeader->slotCount, archiveHeader->namesSize) <= data.length - archiveHeader->tocOffset;
+
+		if (!valid)
+		{
+			UnmapFile(data);
+			return false;
+		}
+
+		const ArchiveEntry* archiveEntries = reinterpret_cast<const ArchiveEntry*>(data.data + archiveHeader->tocOffset);
+		const uint32* archiveSlots = reinterpret_cast<const uint32*>(archiveEntries + archiveHeader->entryCount);
+
+		// Checked once up front so lookups don't need to
+		for (uint32 entryIdx = 0; entryIdx < archiveHeader->entryCount && valid; ++entryIdx)
+		{
+			const ArchiveEntry& entry = archiveEntries[entryIdx];
+			valid = entry.offset <= archiveHeader->tocOffset && entry.storedSize <= archiveHeader->tocOffset - entry.offset &&
+				uint64(entry.nameOffset) + entry.nameLength <= archiveHeader->namesSize &&
+				(entry.compression == ArchiveCompression::Block || (entry.compression == ArchiveCompression::None && entry.size == entry.storedSize));
+		}
+
+		for (uint32 slotIdx = 0; slotIdx < archiveHeader->slotCount && valid; ++slotIdx)
+		{
+			valid = archiveSlots[slotIdx] <= archiveHeader->entryCount;
+		}
+
+		if (!valid)
+		{
+			UnmapFile(data);
+			return false;
+		}
+
+		header = archiveHeader;
+		entries = archiveEntries;
+		slots = archiveSlots;
+		names = reinterpret_cast<const char*>(archiveSlots + archiveHeader->slotCount);
+		mapping = data;
+
+		return true;
+	}
+
+	void Archive::Close()
+	{
+		UnmapFile(mapping);
+		*this = {};
+	}
+
+	const ArchiveEntry* Archive::FindEntry(String name) const
+	{
+		if (!header)
+		{
+			return nullptr;
+		}
+
+		uint64 nameHash = MemoryHash(name.data, name.length);
+		uint32 slotMask = header->slotCount - 1;
+
+		for (uint32 slotIdx = uint32(nameHash) & slotMask, probeCount = 0; probeCount < header->slotCount; slotIdx = (slotIdx + 1) & slotMask, ++probeCount)
+		{
+			uint32 entryIdx = slots[slotIdx];
+			if (entryIdx == 0)
+			{
+				break;
+			}
+
+			const ArchiveEntry* entry = &entries[entryIdx - 1];
+			if (entry->nameHash == nameHash && GetName(entry) == name)
+			{
+				return entry;
+			}
+		}
+
+		return nullptr;
+	}
+
+	TSpan<uint8> Archive::Find(String name) const
+	{
+		const ArchiveEntry* entry = FindEntry(name);
+		if (!entry || entry->compression != ArchiveCompression::None)
+		{
+			return {};
+		}
+
+		return GetData(entry);
+	}
+
+	String Archive::GetName(const ArchiveEntry* entry) const
+	{
+		return String(names + entry->nameOffset, entry->nameLength);
+	}
+
+	TSpan<uint8> Archive::GetData(const ArchiveEntry* entry) const
+	{
+		return TSpan(mapping.data + entry->offset, entry->storedSize);
+	}
+
+	bool Archive::Read(const ArchiveEntry* entry, TSpan<uint8> dst) const
+	{
+		if (dst.length < entry->size)
+		{
+			return false;
+		}
+
+		TSpan<uint8> data = GetData(entry);
+
+		if (entry->compression == ArchiveCompression::None)
+		{
+			MemoryCopy(dst.data, data.data, data.length);
+			return true;
+		}
+
+		size_t decompressedSize = 0;
+		return DecompressBlock(data, TSpan(dst.data, entry->size), decompressedSize) && decompressedSize == entry->size;
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "BkCore.h"
+#include "BkFile.h"
+#include "BkSpan.h"
+#include "BkString.h"
+
+namespace Bk
+{
+	struct Arena;
+
+	constexpr uint32 ArchiveDefaultAlignment = 64;
+
+	enum class ArchiveCompression : uint32
+	{
+		None,
+		Block, // CompressBlock, read through Archive::Read
+	};
+
+	// Layout: header, aligned blobs, then the entry table, the lookup slots and the names
+	struct ArchiveHeader
+	{
+		static constexpr uint32 Magic = 0x4B504B42; // 'BKPK'
+		static constexpr uint32 Version = 1;
+
+		uint32 magic;
+		uint32 version;
+		uint64 size;
+		uint64 tocOffset;
+		uint32 entryCount;
+		uint32 slotCount; // Power of two, slots hold an entry index + 1 or 0 when empty
+		uint32 namesSize;
+		uint32 alignment;
+	};
+
+	struct ArchiveEntry
+	{
+		uint64 nameHash; // MemoryHash of the name
+		uint64 offset;
+		uint64 storedSize;
+		uint64 size; // Equal to storedSize when not compressed
+		uint32 nameOffset;
+		uint32 nameLength;
+		ArchiveCompression compression;
+		uint32 reserved;
+	};
+
+	// Streams blobs straight to the file as they are added, the table of contents is written by Finish
+	struct ArchiveBuilder
+	{
+		bool Begin(Arena* arena, const char* path, uint32 maxEntries, uint32 alignment = ArchiveDefaultAlignment);
+
+		// Compressed entries are stored uncompressed when compression doesn't make them smaller
+		bool Add(String name, TSpan<uint8> data, bool compress = false);
+		bool Finish();
+
+		Arena* arena;
+		FileHandle handle;
+		ArchiveEntry* entries;
+		const char** names;
+		uint32 entryCount;
+		uint32 maxEntries;
+		uint32 alignment;
+		uint64 offset;
+		uint64 namesSize;
+		bool failed;
+	};
+
+	// Maps the whole archive once, uncompressed blobs are returned as views into the mapping
+	struct Archive
+	{
+		bool Open(const char* path);
+		void Close();
+
+		const ArchiveEntry* FindEntry(String name) const;
+		TSpan<uint8> Find(String name) const; // Empty for compressed entries
+
+		String GetName(const ArchiveEntry* entry) const;
+		TSpan<uint8> GetData(const ArchiveEntry* entry) const;
+
+		// Copies or decompresses the entry, dst must hold at least entry->size bytes
+		bool Read(const ArchiveEntry* entry, TSpan<uint8> dst) const;
+
+		const ArchiveHeader* header;
+		const ArchiveEntry* entries;
+		const uint32* slots;
+		const char* names;
+		TSpan<uint8> mapping;
+	};
+}
@@ -35,9 +35,12 @@ namespace Bk
 		}
 	}
 
-	uint8* Arena::Push(size_t size, size_t alignment)
+	uint8* Arena::Push(size_t size, size_t alignment, MemorySite site)
 	{
-		size_t alignedOffset = currentBlock ? AlignUp(currentBlock->offset, alignment) : 0;
+		// Align the address rather than the offset, blocks are only as aligned as the allocator makes them
+		uintptr_t blockAddress = reinterpret_cast<uintptr_t>(currentBlock);
+		size_t alignedOffset = currentBlock ? AlignUp(blockAddress + currentBlock->offset, alignment) - blockAddress : 0;
+
 		if (!currentBlock || alignedOffset + size > currentBlock->size)
 		{
 			if (blockAlignment == 0)
@@ -45,10 +48,9 @@ namespace Bk
 				blockAlignment = DefaultBlockAlignment;
 			}
 
-			alignedOffset = AlignUp(sizeof(ArenaBlock), alignment);
-
-			size_t blockSize = AlignUp(alignedOffset + size, blockAlignment);
-			ArenaBlock* block = static_cast<ArenaBlock*>(MemoryAllocate(blockSize));
+			size_t blockSize = AlignUp(sizeof(ArenaBlock) + (alignment - 1) + size, blockAlignment);
+			MemoryTag blockTag = tag != MemoryTag::General ? tag : MemoryTag::Arena;
+			ArenaBlock* block = static_cast<ArenaBlock*>(MemoryAllocate(blockSize, blockTag, site));
 
 			if (!block)
 			{
@@ -59,15 +61,18 @@ namespace Bk
 			block->size = blockSize;
 
 			currentBlock = block;
+
+			blockAddress = reinterpret_cast<uintptr_t>(currentBlock);
+			alignedOffset = AlignUp(blockAddress + sizeof(ArenaBlock), alignment) - blockAddress;
 		}
 
 		currentBlock->offset = alignedOffset + size;
 		return reinterpret_cast<uint8*>(currentBlock) + alignedOffset;
 	}
 
-	uint8* Arena::PushZeroed(size_t size, size_t alignment)
+	uint8* Arena::PushZeroed(size_t size, size_t alignment, MemorySite site)
 	{
-		uint8* result = Push(size, alignment);
+		uint8* result = Push(size, alignment, site);
 		MemoryZero(result, size);
 
 		return result;
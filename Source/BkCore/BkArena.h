@@ -1,6 +1,7 @@
 #pragma once
 
 #include "BkCore.h"
+#include "BkMemory.h"
 
 namespace Bk
 {
@@ -25,33 +26,35 @@ namespace Bk
 		ArenaMarker GetMarker() const;
 		void SetMarker(ArenaMarker marker);
 
-		uint8* Push(size_t size, size_t alignment = DefaultAlignment);
-		uint8* PushZeroed(size_t size, size_t alignment = DefaultAlignment);
+		// Site is only recorded for pushes that need a new block
+		uint8* Push(size_t size, size_t alignment = DefaultAlignment, MemorySite site = MemorySite::Current());
+		uint8* PushZeroed(size_t size, size_t alignment = DefaultAlignment, MemorySite site = MemorySite::Current());
 
 		template<typename Type>
-		Type* Push(size_t count = 1);
+		Type* Push(size_t count = 1, MemorySite site = MemorySite::Current());
 
 		template<typename Type>
-		Type* PushZeroed(size_t count = 1);
+		Type* PushZeroed(size_t count = 1, MemorySite site = MemorySite::Current());
 
 		ArenaBlock* currentBlock;
 		size_t blockAlignment;
+		MemoryTag tag; // Blocks are tracked under MemoryTag::Arena while left at General
 	};
 }
 
 namespace Bk
 {
 	template<typename Type>
-	Type* Arena::Push(size_t count)
+	Type* Arena::Push(size_t count, MemorySite site)
 	{
-		uint8* result = Push(sizeof(Type) * count, alignof(Type));
+		uint8* result = Push(sizeof(Type) * count, alignof(Type), site);
 		return reinterpret_cast<Type*>(result);
 	}
 
 	template<typename Type>
-	Type* Arena::PushZeroed(size_t count)
+	Type* Arena::PushZeroed(size_t count, MemorySite site)
 	{
-		uint8* result = PushZeroed(sizeof(Type) * count, alignof(Type));
+		uint8* result = PushZeroed(sizeof(Type) * count, alignof(Type), site);
 		return reinterpret_cast<Type*>(result);
 	}
 }
@@ -0,0 +1,515 @@
+#include "BkCompression.h"
+
+#include "BkArena.h"
+#include "BkFileStream.h"
+#include "BkMemory.h"
+
+#include <string.h>
+
+namespace Bk
+{
+	constexpr size_t CompressionMinMatch = 4;
+	constexpr size_t CompressionLastLiterals = 5; // The format requires blocks to end in literals
+	constexpr size_t CompressionMatchLimit = 12; // No match may start closer than this to the end
+	constexpr size_t CompressionMaxOffset = 65535;
+	constexpr uint32 CompressionHashBits = 12;
+
+	// Copies are done in fixed-size chunks that the compiler turns into vector loads and stores, which is why the
+	// fast paths need this much slack in both spans
+	constexpr size_t CompressionWildCopy = 16;
+
+	static uint32 CompressionRead32(const uint8* data)
+	{
+		uint32 value;
+		memcpy(&value, data, sizeof(value));
+
+		return value;
+	}
+
+	static uint64 CompressionRead64(const uint8* data)
+	{
+		uint64 value;
+		memcpy(&value, data, sizeof(value));
+
+		return value;
+	}
+
+	static uint32 CompressionHash(uint32 value)
+	{
+		return (value * 2654435761u) >> (32 - CompressionHashBits);
+	}
+
+	static void CompressionWildCopy16(uint8* dst, const uint8* src, uint8* dstEnd)
+	{
+		do
+		{
+			memcpy(dst, src, CompressionWildCopy);
+			dst += CompressionWildCopy;
+			src += CompressionWildCopy;
+		} while (dst < dstEnd);
+	}
+
+	static uint8* WriteCompressionLength(uint8* op, size_t length)
+	{
+		for (; length >= 255; length -= 255)
+		{
+			*op++ = 255;
+		}
+
+		*op++ = static_cast<uint8>(length);
+		return op;
+	}
+
+	static size_t CountCompressionMatch(const uint8* ip, const uint8* match, const uint8* limit)
+	{
+		const uint8* start = ip;
+
+		while (ip + sizeof(uint64) <= limit)
+		{
+			uint64 difference = CompressionRead64(ip) ^ CompressionRead64(match);
+			if (difference != 0)
+			{
+				return size_t(ip - start) + CountTrailingZeros(difference) / 8;
+			}
+
+			ip += sizeof(uint64);
+			match += sizeof(uint64);
+		}
+
+		while (ip < limit && *ip == *match)
+		{
+			ip += 1;
+			match += 1;
+		}
+
+		return size_t(ip - start);
+	}
+
+	// Token, extended literal length and literals. Returns nullptr if they don't fit in the output
+	static uint8* WriteCompressionLiterals(uint8* op, uint8* outEnd, const uint8* literals, size_t literalLength, uint8 matchToken)
+	{
+		if (size_t(outEnd - op) < 1 + literalLength / 255 + 1 + literalLength)
+		{
+			return nullptr;
+		}
+
+		uint8* token = op++;
+
+		if (literalLength >= 15)
+		{
+			*token = static_cast<uint8>(0xF0 | matchToken);
+			op = WriteCompressionLength(op, literalLength - 15);
+		}
+		else
+		{
+			*token = static_cast<uint8>((literalLength << 4) | matchToken);
+		}
+
+		memcpy(op, literals, literalLength);
+		return op + literalLength;
+	}
+
+	size_t CompressBlock(TSpan<uint8> src, TSpan<uint8> dst)
+	{
+		if (src.length > 0x7E000000)
+		{
+			return 0;
+		}
+
+		const uint8* base = src.data;
+		const uint8* ip = base;
+		const uint8* anchor = base;
+		const uint8* end = base + src.length;
+
+		uint8* op = dst.data;
+		uint8* outEnd = dst.data + dst.length;
+
+		if (src.length > CompressionMatchLimit)
+		{
+			const uint8* matchLimit = end - CompressionLastLiterals;
+			const uint8* searchLimit = end - CompressionMatchLimit;
+
+			uint32 table[1 << CompressionHashBits] = {};
+
+			ip += 1;
+
+			while (ip <= searchLimit)
+			{
+				// Skip ahead faster the longer nothing matches, incompressible data is then mostly copied through
+				const uint8* match = nullptr;
+				uint32 attempts = 1 << 6;
+
+				for (; ip <= searchLimit; ip += attempts++ >> 6)
+				{
+					uint32 sequence = CompressionRead32(ip);
+					uint32 hash = CompressionHash(sequence);
+
+					const uint8* candidate = base + table[hash];
+					table[hash] = uint32(ip - base);
+
+					if (candidate < ip && size_t(ip - candidate) <= CompressionMaxOffset && CompressionRead32(candidate) == sequence)
+					{
+						match = candidate;
+						break;
+					}
+				}
+
+				if (!match)
+				{
+					break;
+				}
+
+				while (ip > anchor && match > base && ip[-1] == match[-1])
+				{
+					ip -= 1;
+					match -= 1;
+				}
+
+				size_t matchLength = CountCompressionMatch(ip + CompressionMinMatch, match + CompressionMinMatch, matchLimit);
+				uint8 matchToken = static_cast<uint8>(BK_MIN(matchLength, size_t(15)));
+
+				op = WriteCompressionLiterals(op, outEnd, anchor, size_t(ip - anchor), matchToken);
+				if (!op || size_t(outEnd - op) < 2 + 1 + matchLength / 255)
+				{
+					return 0;
+				}
+
+				uint16 offset = static_cast<uint16>(ip - match);
+				*op++ = static_cast<uint8>(offset);
+				*op++ = static_cast<uint8>(offset >> 8);
+
+				if (matchLength >= 15)
+				{
+					op = WriteCompressionLength(op, matchLength - 15);
+				}
+
+				ip += CompressionMinMatch + matchLength;
+				anchor = ip;
+
+				if (ip <= searchLimit)
+				{
+					table[CompressionHash(CompressionRead32(ip - 2))] = uint32(ip - 2 - base);
+				}
+			}
+		}
+
+		op = WriteCompressionLiterals(op, outEnd, anchor, size_t(end - anchor), 0);
+		return op ? size_t(op - dst.data) : 0;
+	}
+
+	static bool ReadCompressionLength(const uint8*& ip, const uint8* inEnd, size_t& length)
+	{
+		uint8 value;
+
+		do
+		{
+			if (ip == inEnd)
+			{
+				return false;
+			}
+
+			value = *ip++;
+			length += value;
+		} while (value == 255);
+
+		return true;
+	}
+
+	bool DecompressBlock(TSpan<uint8> src, TSpan<uint8> dst, size_t& decompressedSize)
+	{
+		const uint8* ip = src.data;
+		const uint8* inEnd = src.data + src.length;
+
+		uint8* op = dst.data;
+		uint8* outEnd = dst.data + dst.length;
+
+		decompressedSize = 0;
+
+		while (ip < inEnd)
+		{
+			uint8 token = *ip++;
+
+			size_t literalLength = token >> 4;
+
+			if (literalLength != 15 && size_t(inEnd - ip) >= CompressionWildCopy + 2 && size_t(outEnd - op) >= 2 * CompressionWildCopy)
+			{
+				// Short literals followed by a short match are the common case, the checks above cover both copies
+				memcpy(op, ip, CompressionWildCopy);
+				ip += literalLength;
+				op += literalLength;
+
+				size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+				size_t matchLength = token & 15;
+
+				if (matchLength != 15 && offset >= sizeof(uint64) && offset <= size_t(op - dst.data))
+				{
+					const uint8* match = op - offset;
+					memcpy(op, match, 8);
+					memcpy(op + 8, match + 8, 8);
+					memcpy(op + 16, match + 16, 2);
+
+					ip += 2;
+					op += matchLength + CompressionMinMatch;
+					continue;
+				}
+			}
+			else
+			{
+				if (literalLength == 15 && !ReadCompressionLength(ip, inEnd, literalLength))
+				{
+					return false;
+				}
+
+				if (literalLength > size_t(inEnd - ip) || literalLength > size_t(outEnd - op))
+				{
+					return false;
+				}
+
+				if (size_t(inEnd - ip) >= literalLength + CompressionWildCopy && size_t(outEnd - op) >= literalLength + CompressionWildCopy)
+				{
+					CompressionWildCopy16(op, ip, op + literalLength);
+				}
+				else
+				{
+					memmove(op, ip, literalLength);
+				}
+
+				ip += literalLength;
+				op += literalLength;
+
+				if (ip == inEnd)
+				{
+					// The last sequence only has literals
+					decompressedSize = size_t(op - dst.data);
+					return true;
+				}
+			}
+
+			if (inEnd - ip < 2)
+			{
+				return false;
+			}
+
+			size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+			ip += 2;
+
+			if (offset == 0 || offset > size_t(op - dst.data))
+			{
+				return false;
+			}
+
+			size_t matchLength = token & 15;
+			if (matchLength == 15 && !ReadCompressionLength(ip, inEnd, matchLength))
+			{
+				return false;
+			}
+
+			matchLength += CompressionMinMatch;
+			if (matchLength > size_t(outEnd - op))
+			{
+				return false;
+			}
+
+			const uint8* match = op - offset;
+			uint8* matchEnd = op + matchLength;
+
+			if (offset >= CompressionWildCopy && size_t(outEnd - op) >= matchLength + CompressionWildCopy)
+			{
+				// Far enough back that each chunk only reads bytes that are already final
+				CompressionWildCopy16(op, match, matchEnd);
+			}
+			else if (size_t(outEnd - op) >= matchLength + CompressionWildCopy)
+			{
+				if (offset < sizeof(uint64))
+				{
+					// Expand the repeating pattern until the distance to it is at least 8 bytes, after which whole
+					// chunks can be copied
+					static constexpr uint8 patternAdvance[8] = { 0, 1, 2, 1, 0, 4, 4, 4 };
+					static constexpr int8 patternRewind[8] = { 0, 0, 0, -1, -4, 1, 2, 3 };
+
+					op[0] = match[0];
+					op[1] = match[1];
+					op[2] = match[2];
+					op[3] = match[3];
+
+					match += patternAdvance[offset];
+					memcpy(op + 4, match, 4);
+					match -= patternRewind[offset];
+				}
+				else
+				{
+					memcpy(op, match, sizeof(uint64));
+					match += sizeof(uint64);
+				}
+
+				for (uint8* copy = op + sizeof(uint64); copy < matchEnd; copy += sizeof(uint64), match += sizeof(uint64))
+				{
+					memcpy(copy, match, sizeof(uint64));
+				}
+			}
+			else
+			{
+				// Near the end of the output, copy exactly
+				for (uint8* copy = op; copy < matchEnd; ++copy, ++match)
+				{
+					*copy = *match;
+				}
+			}
+
+			op = matchEnd;
+		}
+
+		// Valid blocks always end with a literal-only sequence
+		return false;
+	}
+
+	bool CompressedWriter::Initialize(Arena* arena, FileWriter* fileWriter, size_t frameBlockSize)
+	{
+		BK_ASSERT(frameBlockSize > 0 && frameBlockSize < CompressionFrameHeader::StoredFlag);
+
+		writer = fileWriter;
+		blockSize = frameBlockSize;
+		block = arena->Push(blockSize);
+		compressed = arena->Push(GetCompressBound(blockSize));
+		length = 0;
+
+		CompressionFrameHeader header = {};
+		header.magic = CompressionFrameHeader::Magic;
+		header.blockSize = static_cast<uint32>(blockSize);
+
+		return writer->Write(TSpan(reinterpret_cast<uint8*>(&header), sizeof(header)));
+	}
+
+	static bool WriteCompressedBlock(CompressedWriter& writer)
+	{
+		if (writer.length == 0)
+		{
+			return true;
+		}
+
+		// Only stored compressed when it is actually smaller
+		size_t compressedSize = CompressBlock(TSpan(writer.block, writer.length), TSpan(writer.compressed, writer.length - 1));
+
+		uint32 blockHeader = compressedSize > 0 ? uint32(compressedSize) : uint32(writer.length) | CompressionFrameHeader::StoredFlag;
+		uint8* blockData = compressedSize > 0 ? writer.compressed : writer.block;
+		size_t blockDataSize = compressedSize > 0 ? compressedSize : writer.length;
+
+		writer.length = 0;
+
+		return writer.writer->Write(TSpan(reinterpret_cast<uint8*>(&blockHeader), sizeof(blockHeader))) &&
+			writer.writer->Write(TSpan(blockData, blockDataSize));
+	}
+
+	bool CompressedWriter::Write(TSpan<uint8> data)
+	{
+		while (data.length > 0)
+		{
+			size_t copySize = BK_MIN(blockSize - length, data.length);
+			MemoryCopy(block + length, data.data, copySize);
+
+			length += copySize;
+			data = TSpan(data.data + copySize, data.length - copySize);
+
+			if (length == blockSize && !WriteCompressedBlock(*this))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool CompressedWriter::Finish()
+	{
+		uint32 endMarker = 0;
+		return WriteCompressedBlock(*this) && writer->Write(TSpan(reinterpret_cast<uint8*>(&endMarker), sizeof(endMarker)));
+	}
+
+	bool CompressedReader::Initialize(Arena* arena, FileReader* fileReader)
+	{
+		reader = fileReader;
+		position = 0;
+		length = 0;
+		finished = false;
+		failed = true;
+
+		CompressionFrameHeader header = {};
+		if (reader->Read(TSpan(reinterpret_cast<uint8*>(&header), sizeof(header))) != sizeof(header) ||
+			header.magic != CompressionFrameHeader::Magic || header.blockSize == 0 || header.blockSize >= CompressionFrameHeader::StoredFlag)
+		{
+			return false;
+		}
+
+		blockSize = header.blockSize;
+		block = arena->Push(blockSize);
+		compressed = arena->Push(blockSize);
+		failed = false;
+
+		return true;
+	}
+
+	static bool ReadCompressedBlock(CompressedReader& reader)
+	{
+		uint32 blockHeader = 0;
+		if (reader.reader->Read(TSpan(reinterpret_cast<uint8*>(&blockHeader), sizeof(blockHeader))) != sizeof(blockHeader))
+		{
+			reader.failed = true;
+			return false;
+		}
+
+		if (blockHeader == 0)
+		{
+			reader.finished = true;
+			return false;
+		}
+
+		bool stored = (blockHeader & CompressionFrameHeader::StoredFlag) != 0;
+		size_t blockDataSize = blockHeader & ~CompressionFrameHeader::StoredFlag;
+
+		// Compressed blocks are only kept when smaller than the block, so both kinds fit either buffer
+		if (blockDataSize > reader.blockSize)
+		{
+			reader.failed = true;
+			return false;
+		}
+
+		uint8* blockData = stored ? reader.block : reader.compressed;
+		if (reader.reader->Read(TSpan(blockData, blockDataSize)) != blockDataSize)
+		{
+			reader.failed = true;
+			return false;
+		}
+
+		reader.position = 0;
+		reader.length = blockDataSize;
+
+		if (!stored && !DecompressBlock(TSpan(reader.compressed, blockDataSize), TSpan(reader.block, reader.blockSize), reader.length))
+		{
+			reader.failed = true;
+			return false;
+		}
+
+		return true;
+	}
+
+	size_t CompressedReader::Read(TSpan<uint8> data)
+	{
+		size_t totalBytesRead = 0;
+
+		while (totalBytesRead < data.length)
+		{
+			if (position == length && (finished || failed || !ReadCompressedBlock(*this)))
+			{
+				break;
+			}
+
+			size_t copySize = BK_MIN(length - position, data.length - totalBytesRead);
+			MemoryCopy(data.data + totalBytesRead, block + position, copySize);
+
+			position += copySize;
+			totalBytesRead += copySize;
+		}
+
+		return totalBytesRead;
+	}
+}
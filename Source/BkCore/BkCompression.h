@@ -0,0 +1,68 @@
+#pragma once
+
+#include "BkCore.h"
+#include "BkMemory.h"
+#include "BkSpan.h"
+
+namespace Bk
+{
+	struct Arena;
+	struct FileReader;
+	struct FileWriter;
+
+	// LZ4 block format, so blocks can be inspected and produced by standard tools
+	constexpr size_t GetCompressBound(size_t size)
+	{
+		return size + size / 255 + 16;
+	}
+
+	// Returns the compressed size, or 0 if it doesn't fit in dst
+	size_t CompressBlock(TSpan<uint8> src, TSpan<uint8> dst);
+
+	// Never writes past dst, fails on malformed input or if the output doesn't fit
+	bool DecompressBlock(TSpan<uint8> src, TSpan<uint8> dst, size_t& decompressedSize);
+
+	// Frame: 'BKLZ', the block size, then blocks prefixed with their size (top bit set when stored uncompressed) and
+	// a zero size to mark the end. Blocks are independent, so a frame is produced and consumed one block at a time
+	struct CompressionFrameHeader
+	{
+		static constexpr uint32 Magic = 0x5A4C4B42; // 'BKLZ'
+		static constexpr uint32 StoredFlag = 0x80000000u;
+
+		uint32 magic;
+		uint32 blockSize;
+	};
+
+	struct CompressedWriter
+	{
+		bool Initialize(Arena* arena, FileWriter* fileWriter, size_t blockSize = BK_KILOBYTES(64));
+
+		bool Write(TSpan<uint8> data);
+
+		// Writes the last block and the end of the frame, the file writer still needs to be finished
+		bool Finish();
+
+		FileWriter* writer;
+		uint8* block;
+		uint8* compressed;
+		size_t blockSize;
+		size_t length;
+	};
+
+	struct CompressedReader
+	{
+		bool Initialize(Arena* arena, FileReader* fileReader);
+
+		// Returns less than requested at the end of the frame or on corrupt data
+		size_t Read(TSpan<uint8> data);
+
+		FileReader* reader;
+		uint8* block;
+		uint8* compressed;
+		size_t blockSize;
+		size_t position;
+		size_t length;
+		bool finished;
+		bool failed;
+	};
+}
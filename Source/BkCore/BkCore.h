@@ -9,6 +9,8 @@
 #define BK_PLATFORM_MACOS
 #elif defined(__EMSCRIPTEN__)
 #define BK_PLATFORM_EMSCRIPTEN
+#elif defined(__linux__)
+#define BK_PLATFORM_LINUX
 #endif
 
 #define BK_ARRAY_COUNT(x) (sizeof(x) / sizeof((x)[0]))
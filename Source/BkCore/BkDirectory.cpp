@@ -0,0 +1,333 @@
+#include "BkDirectory.h"
+
+#include "BkArena.h"
+#include "BkMemory.h"
+
+#if defined(BK_PLATFORM_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(BK_PLATFORM_LINUX)
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace Bk
+{
+#if defined(BK_PLATFORM_LINUX)
+	// Large enough that most directories are read in a single syscall
+	constexpr size_t DirectoryBufferSize = BK_KILOBYTES(32);
+
+	// Layout returned by getdents64, glibc only declares it with _GNU_SOURCE
+	struct LinuxDirent64
+	{
+		uint64 inode;
+		int64 offset;
+		uint16 recordLength;
+		uint8 type;
+		char name[1];
+	};
+
+	constexpr uint8 LinuxDirentUnknown = 0;
+	constexpr uint8 LinuxDirentDirectory = 4;
+	constexpr uint8 LinuxDirentFile = 8;
+#endif
+
+	struct DirectoryLevel
+	{
+		DirectoryLevel* parent;
+		String path;
+
+#if defined(BK_PLATFORM_WINDOWS)
+		HANDLE findHandle;
+		WIN32_FIND_DATAA findData;
+		bool hasFindData;
+#elif defined(BK_PLATFORM_LINUX)
+		int handle;
+		uint8* buffer;
+		size_t position;
+		size_t length;
+#else
+		DIR* directory;
+#endif
+	};
+
+	static String JoinDirectoryPath(Arena* arena, String directory, String name)
+	{
+		bool needsSeparator = directory.length > 0 && directory[directory.length - 1] != '/' && directory[directory.length - 1] != '\\';
+		size_t pathLength = directory.length + (needsSeparator ? 1 : 0) + name.length;
+
+		char* path = reinterpret_cast<char*>(arena->Push(pathLength + 1, 1));
+		MemoryCopy(path, directory.data, directory.length);
+
+		if (needsSeparator)
+		{
+			path[directory.length] = '/';
+		}
+
+		MemoryCopy(path + pathLength - name.length, name.data, name.length);
+		path[pathLength] = '\0';
+
+		return String(path, pathLength);
+	}
+
+	static bool OpenDirectoryLevel(DirectoryLevel* level, String name)
+	{
+#if defined(BK_PLATFORM_WINDOWS)
+		TStringBuffer<MAX_PATH + 2> pattern(level->path);
+		if (!pattern.Append("/*"))
+		{
+			return false;
+		}
+
+		// Basic info skips the short 8.3 names, large fetch returns more entries per call
+		level->findHandle = FindFirstFileExA(pattern.data, FindExInfoBasic, &level->findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+		level->hasFindData = true;
+
+		return level->findHandle != INVALID_HANDLE_VALUE;
+#elif defined(BK_PLATFORM_LINUX)
+		// Subdirectories are opened relative to their parent, so the kernel doesn't walk the whole path again
+		int parentHandle = level->parent ? level->parent->handle : AT_FDCWD;
+		const char* openPath = level->parent ? name.data : level->path.data;
+
+		// Only entries are kept from following links, the root is whatever path the caller passed in
+		int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC | (level->parent ? O_NOFOLLOW : 0);
+
+		do
+		{
+			level->handle = openat(parentHandle, openPath, flags);
+		} while (level->handle == -1 && errno == EINTR);
+
+		level->position = 0;
+		level->length = 0;
+
+		return level->handle != -1;
+#else
+		level->directory = opendir(level->path.data);
+		return level->directory != nullptr;
+#endif
+	}
+
+	static void CloseDirectoryLevel(DirectoryLevel* level)
+	{
+#if defined(BK_PLATFORM_WINDOWS)
+		FindClose(level->findHandle);
+#elif defined(BK_PLATFORM_LINUX)
+		close(level->handle);
+#else
+		closedir(level->directory);
+#endif
+	}
+
+	static bool ReadDirectoryLevel(DirectoryLevel* level, String& name, DirectoryEntryType& type)
+	{
+#if defined(BK_PLATFORM_WINDOWS)
+		if (!level->hasFindData && !FindNextFileA(level->findHandle, &level->findData))
+		{
+			return false;
+		}
+
+		level->hasFindData = false;
+
+		DWORD attributes = level->findData.dwFileAttributes;
+		name = String(level->findData.cFileName);
+
+		if (attributes & FILE_ATTRIBUTE_REPARSE_POINT)
+		{
+			type = DirectoryEntryType::Other;
+		}
+		else if (attributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			type = DirectoryEntryType::Directory;
+		}
+		else
+		{
+			type = DirectoryEntryType::File;
+		}
+
+		return true;
+#elif defined(BK_PLATFORM_LINUX)
+		if (level->position == level->length)
+		{
+			long bytesRead = syscall(SYS_getdents64, level->handle, level->buffer, DirectoryBufferSize);
+			if (bytesRead <= 0)
+			{
+				return false;
+			}
+
+			level->position = 0;
+			level->length = static_cast<size_t>(bytesRead);
+		}
+
+		const LinuxDirent64* dirent = reinterpret_cast<const LinuxDirent64*>(level->buffer + level->position);
+		level->position += dirent->recordLength;
+
+		name = String(dirent->name);
+
+		uint8 direntType = dirent->type;
+		if (direntType == LinuxDirentUnknown)
+		{
+			// Some file systems don't fill in the type
+			struct stat fileStat = {};
+			if (fstatat(level->handle, dirent->name, &fileStat, AT_SYMLINK_NOFOLLOW) == 0)
+			{
+				direntType = S_ISDIR(fileStat.st_mode) ? LinuxDirentDirectory : S_ISREG(fileStat.st_mode) ? LinuxDirentFile : LinuxDirentUnknown;
+			}
+		}
+
+		if (direntType == LinuxDirentDirectory)
+		{
+			type = DirectoryEntryType::Directory;
+		}
+		else if (direntType == LinuxDirentFile)
+		{
+			type = DirectoryEntryType::File;
+		}
+		else
+		{
+			type = DirectoryEntryType::Other;
+		}
+
+		return true;
+#else
+		struct dirent* dirent = readdir(level->directory);
+		if (!dirent)
+		{
+			return false;
+		}
+
+		name = String(dirent->d_name);
+
+		uint8 direntType = dirent->d_type;
+		if (direntType == DT_UNKNOWN)
+		{
+			// Rare enough that building the full path here is fine
+			TStringBuffer<1024> path(level->path);
+			path.Append('/');
+			path.Append(name);
+
+			struct stat fileStat = {};
+			if (lstat(path.data, &fileStat) == 0)
+			{
+				direntType = S_ISDIR(fileStat.st_mode) ? DT_DIR : S_ISREG(fileStat.st_mode) ? DT_REG : DT_UNKNOWN;
+			}
+		}
+
+		if (direntType == DT_DIR)
+		{
+			type = DirectoryEntryType::Directory;
+		}
+		else if (direntType == DT_REG)
+		{
+			type = DirectoryEntryType::File;
+		}
+		else
+		{
+			type = DirectoryEntryType::Other;
+		}
+
+		return true;
+#endif
+	}
+
+	static bool PushDirectoryLevel(DirectoryIterator& iterator, String path, String name)
+	{
+		// Levels and their buffers are recycled, so a deep walk only allocates for its maximum depth
+		DirectoryLevel* level = iterator.freeLevels;
+		if (level)
+		{
+			iterator.freeLevels = level->parent;
+		}
+		else
+		{
+			level = iterator.arena->Push<DirectoryLevel>();
+
+#if defined(BK_PLATFORM_LINUX)
+			level->buffer = iterator.arena->Push(DirectoryBufferSize, alignof(LinuxDirent64));
+#endif
+		}
+
+		level->parent = iterator.level;
+		level->path = path;
+
+		if (!OpenDirectoryLevel(level, name))
+		{
+			level->parent = iterator.freeLevels;
+			iterator.freeLevels = level;
+
+			return false;
+		}
+
+		iterator.level = level;
+		return true;
+	}
+
+	static void PopDirectoryLevel(DirectoryIterator& iterator)
+	{
+		DirectoryLevel* level = iterator.level;
+		CloseDirectoryLevel(level);
+
+		iterator.level = level->parent;
+
+		level->parent = iterator.freeLevels;
+		iterator.freeLevels = level;
+	}
+
+	bool DirectoryIterator::Open(Arena* directoryArena, const char* path, bool recursiveIteration)
+	{
+		arena = directoryArena;
+		level = nullptr;
+		freeLevels = nullptr;
+		recursive = recursiveIteration;
+
+		String rootPath = JoinDirectoryPath(arena, String(path), String());
+		return PushDirectoryLevel(*this, rootPath, rootPath);
+	}
+
+	void DirectoryIterator::Close()
+	{
+		while (level)
+		{
+			PopDirectoryLevel(*this);
+		}
+	}
+
+	bool DirectoryIterator::Next(DirectoryEntry& entry)
+	{
+		while (level)
+		{
+			String name;
+			DirectoryEntryType type;
+
+			if (!ReadDirectoryLevel(level, name, type))
+			{
+				PopDirectoryLevel(*this);
+				continue;
+			}
+
+			if (name == "." || name == "..")
+			{
+				continue;
+			}
+
+			entry.path = JoinDirectoryPath(arena, level->path, name);
+			entry.name = entry.path.Slice(entry.path.length - name.length);
+			entry.type = type;
+
+			// Unreadable subdirectories are still returned, just not descended into
+			if (recursive && type == DirectoryEntryType::Directory)
+			{
+				PushDirectoryLevel(*this, entry.path, entry.name);
+			}
+
+			return true;
+		}
+
+		return false;
+	}
+}
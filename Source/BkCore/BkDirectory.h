@@ -0,0 +1,39 @@
+#pragma once
+
+#include "BkCore.h"
+#include "BkString.h"
+
+namespace Bk
+{
+	struct Arena;
+	struct DirectoryLevel;
+
+	enum class DirectoryEntryType : uint8
+	{
+		File,
+		Directory,
+		Other, // Symbolic links, devices, pipes etc.
+	};
+
+	struct DirectoryEntry
+	{
+		String path; // Joined onto the iterated directory and null terminated, allocated from the arena
+		String name; // Last component of path
+		DirectoryEntryType type;
+	};
+
+	// Lists a directory without stat-ing its entries, optionally descending into subdirectories depth first.
+	// "." and ".." are skipped and symbolic links below the opened path are never followed, the path itself may be one
+	struct DirectoryIterator
+	{
+		bool Open(Arena* arena, const char* path, bool recursive = false);
+		void Close();
+
+		bool Next(DirectoryEntry& entry);
+
+		Arena* arena;
+		DirectoryLevel* level;
+		DirectoryLevel* freeLevels;
+		bool recursive;
+	};
+}
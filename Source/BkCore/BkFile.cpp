@@ -1,12 +1,17 @@
 #include "BkFile.h"
 
+#include "BkArena.h"
+
 #if defined(BK_PLATFORM_WINDOWS)
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #else
 #include <errno.h>
 #include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #endif
 
@@ -33,7 +38,13 @@ namespace Bk
 			disposition = OPEN_ALWAYS;
 		}
 
-		HANDLE osHandle = CreateFileA(path, accessFlags, 0, nullptr, disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+		DWORD attributes = FILE_ATTRIBUTE_NORMAL;
+		if (EnumHasAnyFlags(access, FileAccess::Unbuffered))
+		{
+			attributes |= FILE_FLAG_NO_BUFFERING;
+		}
+
+		HANDLE osHandle = CreateFileA(path, accessFlags, 0, nullptr, disposition, attributes, nullptr);
 		return (osHandle != INVALID_HANDLE_VALUE) ? reinterpret_cast<FileHandle>(osHandle) : 0;
 #else
 		int flags = 0;
@@ -59,8 +70,28 @@ namespace Bk
 		{
 			flags |= O_APPEND;
 		}
+		else if (EnumHasAnyFlags(access, FileAccess::Write))
+		{
+			// Matches CREATE_ALWAYS on Windows
+			flags |= O_TRUNC;
+		}
+
+#if defined(O_DIRECT)
+		if (EnumHasAnyFlags(access, FileAccess::Unbuffered))
+		{
+			flags |= O_DIRECT;
+		}
+#endif
 
 		int osHandle = open(path, flags, 0755);
+
+#if defined(BK_PLATFORM_MACOS)
+		if (osHandle != -1 && EnumHasAnyFlags(access, FileAccess::Unbuffered))
+		{
+			fcntl(osHandle, F_NOCACHE, 1);
+		}
+#endif
+
 		return (osHandle != -1) ? static_cast<FileHandle>(osHandle) : 0;
 #endif
 	}
@@ -80,6 +111,24 @@ namespace Bk
 #endif
 	}
 
+	bool RemoveFile(const char* path)
+	{
+#if defined(BK_PLATFORM_WINDOWS)
+		return DeleteFileA(path);
+#else
+		return unlink(path) == 0;
+#endif
+	}
+
+	bool RenameFile(const char* oldPath, const char* newPath)
+	{
+#if defined(BK_PLATFORM_WINDOWS)
+		return MoveFileExA(oldPath, newPath, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+		return rename(oldPath, newPath) == 0;
+#endif
+	}
+
 	size_t ReadFile(FileHandle handle, TSpan<uint8> buffer)
 	{
 		if (!handle)
@@ -95,10 +144,6 @@ namespace Bk
 
 		while (bytesLeft > 0)
 		{
-			// OVERLAPPED overlapped = {};
-			// overlapped.Offset = static_cast<DWORD>(totalBytesRead);
-			// overlapped.OffsetHigh = static_cast<DWORD>(totalBytesRead >> 32);
-
 			DWORD bytesRead;
 			BOOL result = ::ReadFile(osHandle, buffer.data + totalBytesRead, bytesLeft, &bytesRead, nullptr);
 
@@ -153,10 +198,6 @@ namespace Bk
 
 		while (bytesLeft > 0)
 		{
-			// OVERLAPPED overlapped = {};
-			// overlapped.Offset = static_cast<DWORD>(totalBytesWritten);
-			// overlapped.OffsetHigh = static_cast<DWORD>(totalBytesWritten >> 32);
-
 			DWORD bytesWritten;
 			BOOL result = ::WriteFile(osHandle, buffer.data + totalBytesWritten, bytesLeft, &bytesWritten, nullptr);
 
@@ -196,6 +237,206 @@ namespace Bk
 #endif
 	}
 
+	size_t ReadFileAt(FileHandle handle, uint64 offset, TSpan<uint8> buffer)
+	{
+		if (!handle)
+		{
+			return 0;
+		}
+
+#if defined(BK_PLATFORM_WINDOWS)
+		HANDLE osHandle = reinterpret_cast<HANDLE>(handle);
+
+		size_t totalBytesRead = 0;
+		size_t bytesLeft = buffer.length;
+
+		while (bytesLeft > 0)
+		{
+			uint64 readOffset = offset + totalBytesRead;
+
+			OVERLAPPED overlapped = {};
+			overlapped.Offset = static_cast<DWORD>(readOffset);
+			overlapped.OffsetHigh = static_cast<DWORD>(readOffset >> 32);
+
+			DWORD bytesRead;
+			BOOL result = ::ReadFile(osHandle, buffer.data + totalBytesRead, static_cast<DWORD>(BK_MIN(bytesLeft, size_t(UINT32_MAX))), &bytesRead, &overlapped);
+
+			if (result && bytesRead > 0)
+			{
+				totalBytesRead += bytesRead;
+				bytesLeft -= bytesRead;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		return totalBytesRead;
+#else
+		int osHandle = static_cast<int>(handle);
+
+		size_t totalBytesRead = 0;
+		size_t bytesLeft = buffer.length;
+
+		while (bytesLeft > 0)
+		{
+			ssize_t bytesRead = pread(osHandle, buffer.data + totalBytesRead, bytesLeft, static_cast<off_t>(offset + totalBytesRead));
+			if (bytesRead > 0)
+			{
+				totalBytesRead += static_cast<size_t>(bytesRead);
+				bytesLeft -= static_cast<size_t>(bytesRead);
+			}
+			else if (bytesRead == 0 || errno != EINTR)
+			{
+				break;
+			}
+		}
+
+		return totalBytesRead;
+#endif
+	}
+
+	size_t WriteFileAt(FileHandle handle, uint64 offset, TSpan<uint8> buffer)
+	{
+		if (!handle)
+		{
+			return 0;
+		}
+
+#if defined(BK_PLATFORM_WINDOWS)
+		HANDLE osHandle = reinterpret_cast<HANDLE>(handle);
+
+		size_t totalBytesWritten = 0;
+		size_t bytesLeft = buffer.length;
+
+		while (bytesLeft > 0)
+		{
+			uint64 writeOffset = offset + totalBytesWritten;
+
+			OVERLAPPED overlapped = {};
+			overlapped.Offset = static_cast<DWORD>(writeOffset);
+			overlapped.OffsetHigh = static_cast<DWORD>(writeOffset >> 32);
+
+			DWORD bytesWritten;
+			BOOL result = ::WriteFile(osHandle, buffer.data + totalBytesWritten, static_cast<DWORD>(BK_MIN(bytesLeft, size_t(UINT32_MAX))), &bytesWritten, &overlapped);
+
+			if (result && bytesWritten > 0)
+			{
+				totalBytesWritten += bytesWritten;
+				bytesLeft -= bytesWritten;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		return totalBytesWritten;
+#else
+		int osHandle = static_cast<int>(handle);
+
+		size_t totalBytesWritten = 0;
+		size_t bytesLeft = buffer.length;
+
+		while (bytesLeft > 0)
+		{
+			ssize_t bytesWritten = pwrite(osHandle, buffer.data + totalBytesWritten, bytesLeft, static_cast<off_t>(offset + totalBytesWritten));
+			if (bytesWritten > 0)
+			{
+				totalBytesWritten += static_cast<size_t>(bytesWritten);
+				bytesLeft -= static_cast<size_t>(bytesWritten);
+			}
+			else if (bytesWritten == 0 || errno != EINTR)
+			{
+				break;
+			}
+		}
+
+		return totalBytesWritten;
+#endif
+	}
+
+	static size_t TransferFileVectored(FileHandle handle, uint64 offset, TSpan<TSpan<uint8>> buffers, bool write)
+	{
+		if (!handle)
+		{
+			return 0;
+		}
+
+		size_t totalBytes = 0;
+
+#if defined(BK_PLATFORM_WINDOWS)
+		// Native scatter/gather requires unbuffered, page-aligned I/O, so issue the buffers one by one instead
+		for (TSpan<uint8> buffer : buffers)
+		{
+			size_t bytes = write ? WriteFileAt(handle, offset + totalBytes, buffer) : ReadFileAt(handle, offset + totalBytes, buffer);
+			totalBytes += bytes;
+
+			if (bytes != buffer.length)
+			{
+				break;
+			}
+		}
+#else
+		int osHandle = static_cast<int>(handle);
+
+		size_t bufferIdx = 0;
+		size_t bufferOffset = 0; // Progress into buffers[bufferIdx] after a partial transfer
+
+		while (bufferIdx < buffers.length)
+		{
+			iovec vectors[64];
+			int vectorCount = 0;
+
+			for (size_t idx = bufferIdx; idx < buffers.length && vectorCount < int(BK_ARRAY_COUNT(vectors)); ++idx)
+			{
+				size_t skip = idx == bufferIdx ? bufferOffset : 0;
+
+				vectors[vectorCount].iov_base = buffers.data[idx].data + skip;
+				vectors[vectorCount].iov_len = buffers.data[idx].length - skip;
+				vectorCount += 1;
+			}
+
+			off_t fileOffset = static_cast<off_t>(offset + totalBytes);
+			ssize_t result = write ? pwritev(osHandle, vectors, vectorCount, fileOffset) : preadv(osHandle, vectors, vectorCount, fileOffset);
+
+			if (result < 0 && errno == EINTR)
+			{
+				continue;
+			}
+
+			if (result <= 0)
+			{
+				break;
+			}
+
+			size_t bytes = static_cast<size_t>(result);
+			totalBytes += bytes;
+
+			// Advance past fully transferred buffers, retrying the remainder of a partial one
+			for (bytes += bufferOffset; bufferIdx < buffers.length && bytes >= buffers.data[bufferIdx].length; ++bufferIdx)
+			{
+				bytes -= buffers.data[bufferIdx].length;
+			}
+
+			bufferOffset = bytes;
+		}
+#endif
+
+		return totalBytes;
+	}
+
+	size_t ReadFileVectored(FileHandle handle, uint64 offset, TSpan<TSpan<uint8>> buffers)
+	{
+		return TransferFileVectored(handle, offset, buffers, false);
+	}
+
+	size_t WriteFileVectored(FileHandle handle, uint64 offset, TSpan<TSpan<uint8>> buffers)
+	{
+		return TransferFileVectored(handle, offset, buffers, true);
+	}
+
 	size_t GetFileSize(FileHandle handle)
 	{
 		if (!handle)
@@ -207,16 +448,482 @@ namespace Bk
 		HANDLE osHandle = reinterpret_cast<HANDLE>(handle);
 
 		LARGE_INTEGER fileSize = {};
-		GetFileSizeEx(osHandle, &fileSize);
+		if (!GetFileSizeEx(osHandle, &fileSize))
+		{
+			return 0;
+		}
 
 		return static_cast<size_t>(fileSize.QuadPart);
 #else
 		int osHandle = static_cast<int>(handle);
 
 		struct stat fileStat = {};
-		fstat(osHandle, &fileStat);
+		if (fstat(osHandle, &fileStat) != 0)
+		{
+			return 0;
+		}
 
 		return static_cast<size_t>(fileStat.st_size);
 #endif
 	}
+
+	bool SetFileSize(FileHandle handle, uint64 size)
+	{
+		if (!handle)
+		{
+			return false;
+		}
+
+#if defined(BK_PLATFORM_WINDOWS)
+		HANDLE osHandle = reinterpret_cast<HANDLE>(handle);
+
+		FILE_END_OF_FILE_INFO endOfFile = {};
+		endOfFile.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+
+		return SetFileInformationByHandle(osHandle, FileEndOfFileInfo, &endOfFile, sizeof(endOfFile));
+#else
+		int osHandle = static_cast<int>(handle);
+
+		int result;
+		do
+		{
+			result = ftruncate(osHandle, static_cast<off_t>(size));
+		} while (result == -1 && errno == EINTR);
+
+		return result == 0;
+#endif
+	}
+
+	bool PreallocateFile(FileHandle handle, uint64 size)
+	{
+		if (!handle)
+		{
+			return false;
+		}
+
+#if defined(BK_PLATFORM_WINDOWS)
+		HANDLE osHandle = reinterpret_cast<HANDLE>(handle);
+
+		FILE_ALLOCATION_INFO allocation = {};
+		allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+
+		return SetFileInformationByHandle(osHandle, FileAllocationInfo, &allocation, sizeof(allocation));
+#elif defined(BK_PLATFORM_LINUX)
+		int osHandle = static_cast<int>(handle);
+
+		int result;
+		do
+		{
+			result = fallocate(osHandle, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size));
+		} while (result == -1 && errno == EINTR);
+
+		return result == 0;
+#elif defined(BK_PLATFORM_MACOS)
+		int osHandle = static_cast<int>(handle);
+
+		fstore_t store = {};
+		store.fst_flags = F_ALLOCATECONTIG | F_ALLOCATEALL;
+		store.fst_posmode = F_PEOFPOSMODE;
+		store.fst_length = static_cast<off_t>(size);
+
+		if (fcntl(osHandle, F_PREALLOCATE, &store) == 0)
+		{
+			return true;
+		}
+
+		// Fall back to non-contiguous space
+		store.fst_flags = F_ALLOCATEALL;
+		return fcntl(osHandle, F_PREALLOCATE, &store) == 0;
+#else
+		return false;
+#endif
+	}
+
+	bool SyncFile(FileHandle handle, bool metadata)
+	{
+		if (!handle)
+		{
+			return false;
+		}
+
+#if defined(BK_PLATFORM_WINDOWS)
+		HANDLE osHandle = reinterpret_cast<HANDLE>(handle);
+		return FlushFileBuffers(osHandle);
+#else
+		int osHandle = static_cast<int>(handle);
+
+#if defined(BK_PLATFORM_MACOS)
+		// fsync only reaches the drive's cache on macOS
+		if (fcntl(osHandle, F_FULLFSYNC) == 0)
+		{
+			return true;
+		}
+#endif
+
+		int result;
+		do
+		{
+			result = metadata ? fsync(osHandle) : fdatasync(osHandle);
+		} while (result == -1 && errno == EINTR);
+
+		return result == 0;
+#endif
+	}
+
+	bool GetFileInfo(const char* path, FileInfo& info)
+	{
+		info = {};
+
+#if defined(BK_PLATFORM_WINDOWS)
+		WIN32_FILE_ATTRIBUTE_DATA attributes = {};
+		if (!GetFileAttributesExA(path, GetFileExInfoStandard, &attributes))
+		{
+			return false;
+		}
+
+		// FILETIME counts 100ns intervals since 1601
+		uint64 writeTime = (static_cast<uint64>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+		constexpr uint64 UnixEpochOffset = 116444736000000000ull;
+
+		info.size = (static_cast<uint64>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+		info.modifiedTime = writeTime > UnixEpochOffset ? (writeTime - UnixEpochOffset) * 100 : 0;
+		info.directory = (attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+		struct stat fileStat = {};
+		if (stat(path, &fileStat) != 0)
+		{
+			return false;
+		}
+
+#if defined(BK_PLATFORM_MACOS)
+		const struct timespec& modifiedTime = fileStat.st_mtimespec;
+#else
+		const struct timespec& modifiedTime = fileStat.st_mtim;
+#endif
+
+		info.size = static_cast<uint64>(fileStat.st_size);
+		info.modifiedTime = static_cast<uint64>(modifiedTime.tv_sec) * 1000000000ull + static_cast<uint64>(modifiedTime.tv_nsec);
+		info.directory = S_ISDIR(fileStat.st_mode);
+#endif
+
+		info.exists = true;
+		return true;
+	}
+
+	size_t GetFileInfos(TSpan<const char*> paths, TSpan<FileInfo> infos)
+	{
+		BK_ASSERT(infos.length >= paths.length);
+
+		size_t existCount = 0;
+
+		for (size_t i = 0; i < paths.length; ++i)
+		{
+			if (GetFileInfo(paths.data[i], infos.data[i]))
+			{
+				existCount += 1;
+			}
+		}
+
+		return existCount;
+	}
+
+	TSpan<uint8> LoadFile(Arena& arena, const char* path, LoadFileFlags flags)
+	{
+		FileHandle handle = OpenFile(path, FileAccess::Read);
+		if (!handle)
+		{
+			return {};
+		}
+
+		size_t paddingSize = 0;
+		size_t alignment = Arena::DefaultAlignment;
+
+		if (EnumHasAnyFlags(flags, LoadFileFlags::PadTail))
+		{
+			paddingSize = LoadFilePadding;
+			alignment = LoadFilePadding;
+		}
+		else if (EnumHasAnyFlags(flags, LoadFileFlags::NullTerminate))
+		{
+			paddingSize = 1;
+		}
+
+		size_t fileSize = GetFileSize(handle);
+
+		TSpan<uint8> result(arena.Push(fileSize + paddingSize, alignment), fileSize);
+		result.length = ReadFile(handle, result);
+
+		CloseFile(handle);
+
+		// Zero from the actual end, in case the file shrunk since its size was queried
+		MemoryZero(result.data + result.length, fileSize - result.length + paddingSize);
+
+		return result;
+	}
+
+	String LoadFileString(Arena& arena, const char* path, LoadFileFlags flags)
+	{
+		TSpan<uint8> result = LoadFile(arena, path, flags);
+		return String(reinterpret_cast<const char*>(result.data), result.length);
+	}
+
+	TSpan<uint8> MapFile(FileHandle handle, FileMapFlags flags)
+	{
+		size_t fileSize = GetFileSize(handle);
+		if (fileSize == 0)
+		{
+			return {};
+		}
+
+		const bool copyOnWrite = EnumHasAnyFlags(flags, FileMapFlags::CopyOnWrite);
+
+#if defined(BK_PLATFORM_WINDOWS)
+		HANDLE osHandle = reinterpret_cast<HANDLE>(handle);
+
+		HANDLE mappingHandle = CreateFileMappingA(osHandle, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+		if (!mappingHandle)
+		{
+			return {};
+		}
+
+		// The view keeps the mapping object alive
+		void* data = MapViewOfFile(mappingHandle, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, fileSize);
+		CloseHandle(mappingHandle);
+
+		if (!data)
+		{
+			return {};
+		}
+
+		if (EnumHasAnyFlags(flags, FileMapFlags::Sequential))
+		{
+			WIN32_MEMORY_RANGE_ENTRY range = { .VirtualAddress = data, .NumberOfBytes = fileSize };
+			PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+		}
+
+		return TSpan(static_cast<uint8*>(data), fileSize);
+#else
+		int osHandle = static_cast<int>(handle);
+
+		int protection = copyOnWrite ? (PROT_READ | PROT_WRITE) : PROT_READ;
+		void* data = mmap(nullptr, fileSize, protection, MAP_PRIVATE, osHandle, 0);
+
+		if (data == MAP_FAILED)
+		{
+			return {};
+		}
+
+#if !defined(BK_PLATFORM_EMSCRIPTEN)
+		// Access hints are best effort, failures are ignored
+		if (EnumHasAnyFlags(flags, FileMapFlags::Sequential))
+		{
+			madvise(data, fileSize, MADV_SEQUENTIAL);
+		}
+		else if (EnumHasAnyFlags(flags, FileMapFlags::Random))
+		{
+			madvise(data, fileSize, MADV_RANDOM);
+		}
+
+#if defined(MADV_HUGEPAGE)
+		if (EnumHasAnyFlags(flags, FileMapFlags::HugePages))
+		{
+			madvise(data, fileSize, MADV_HUGEPAGE);
+		}
+#endif
+#endif
+
+		return TSpan(static_cast<uint8*>(data), fileSize);
+#endif
+	}
+
+	void UnmapFile(TSpan<uint8> mapping)
+	{
+		if (!mapping.data)
+		{
+			return;
+		}
+
+#if defined(BK_PLATFORM_WINDOWS)
+		UnmapViewOfFile(mapping.data);
+#else
+		munmap(mapping.data, mapping.length);
+#endif
+	}
+
+	static uint32 atomicFileCounter;
+
+	bool AtomicFile::Begin(Arena* arena, const char* targetPath, uint64 preallocateSize)
+	{
+		String target(targetPath);
+
+#if defined(BK_PLATFORM_WINDOWS)
+		uint32 processId = GetCurrentProcessId();
+#else
+		uint32 processId = static_cast<uint32>(getpid());
+#endif
+
+		// Unique per process and writer, so concurrent writers of the same target never share a temp file
+		constexpr size_t SuffixCapacity = 32;
+		uint32 writerIdx = __atomic_fetch_add(&atomicFileCounter, 1, __ATOMIC_RELAXED);
+
+		char* paths = reinterpret_cast<char*>(arena->Push(target.length * 2 + SuffixCapacity + 2, 1));
+		MemoryCopy(paths, target.data, target.length + 1);
+
+		StringBuffer temp(paths + target.length + 1, target.length + SuffixCapacity + 1);
+		temp.Appendf("%s.%u.%u.tmp", targetPath, processId, writerIdx);
+
+		path = paths;
+		tempPath = temp.data;
+		handle = OpenFile(tempPath, FileAccess::Write);
+		preallocated = handle && preallocateSize > 0 && PreallocateFile(handle, preallocateSize);
+
+		return handle != 0;
+	}
+
+	bool AtomicFile::Commit(bool durable)
+	{
+		return CommitAtomicFiles(TSpan(this, 1), durable);
+	}
+
+	void AtomicFile::Abort()
+	{
+		if (handle)
+		{
+			CloseFile(handle);
+			RemoveFile(tempPath);
+		}
+
+		handle = 0;
+	}
+
+	static String GetDirectoryPath(const char* path)
+	{
+		String result(path);
+		while (result.length > 0 && result[result.length - 1] != '/' && result[result.length - 1] != '\\')
+		{
+			result.length -= 1;
+		}
+
+		return result;
+	}
+
+	static bool SyncDirectory(String directory)
+	{
+#if defined(BK_PLATFORM_WINDOWS)
+		// Renames are already written through
+		return true;
+#else
+		TStringBuffer<1024> directoryPath;
+		if (!directoryPath.Append(directory.length > 0 ? directory : String(".")))
+		{
+			return false;
+		}
+
+		int osHandle = open(directoryPath.data, O_RDONLY);
+		if (osHandle == -1)
+		{
+			return false;
+		}
+
+		bool result = fsync(osHandle) == 0;
+		close(osHandle);
+
+		return result;
+#endif
+	}
+
+	bool CommitAtomicFiles(TSpan<AtomicFile> files, bool durable)
+	{
+		bool result = true;
+
+		for (size_t fileIdx = 0; fileIdx < files.length; ++fileIdx)
+		{
+			AtomicFile& file = files.data[fileIdx];
+			if (!file.handle)
+			{
+				result = false;
+				continue;
+			}
+
+			// Release whatever part of the preallocation wasn't written
+			if (file.preallocated && !SetFileSize(file.handle, GetFileSize(file.handle)))
+			{
+				file.Abort();
+				result = false;
+			}
+		}
+
+		if (durable)
+		{
+			for (size_t fileIdx = 0; fileIdx < files.length; ++fileIdx)
+			{
+				AtomicFile& file = files.data[fileIdx];
+				if (!file.handle)
+				{
+					continue;
+				}
+
+				// Only the file's own data, syncfs would flush the whole file system and, before Linux 5.8, not report
+				// writeback errors for this file
+				if (!SyncFile(file.handle))
+				{
+					file.Abort();
+					result = false;
+				}
+			}
+		}
+
+		String syncedDirectories[16];
+		size_t syncedCount = 0;
+
+		for (size_t fileIdx = 0; fileIdx < files.length; ++fileIdx)
+		{
+			AtomicFile& file = files.data[fileIdx];
+			if (!file.handle)
+			{
+				continue;
+			}
+
+			CloseFile(file.handle);
+			file.handle = 0;
+
+			if (!RenameFile(file.tempPath, file.path))
+			{
+				RemoveFile(file.tempPath);
+				result = false;
+				continue;
+			}
+
+			if (!durable)
+			{
+				continue;
+			}
+
+			// The rename itself is only durable once the directory is synced. Directories are remembered only once their
+			// sync succeeded, past the first few they're simply synced again
+			String directory = GetDirectoryPath(file.path);
+
+			bool synced = false;
+			for (size_t directoryIdx = 0; directoryIdx < syncedCount && !synced; ++directoryIdx)
+			{
+				synced = syncedDirectories[directoryIdx] == directory;
+			}
+
+			if (synced)
+			{
+				continue;
+			}
+
+			if (!SyncDirectory(directory))
+			{
+				result = false;
+			}
+			else if (syncedCount < BK_ARRAY_COUNT(syncedDirectories))
+			{
+				syncedDirectories[syncedCount++] = directory;
+			}
+		}
+
+		return result;
+	}
 }
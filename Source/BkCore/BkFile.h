@@ -1,26 +1,117 @@
 #pragma once
 
 #include "BkCore.h"
+#include "BkMemory.h"
 #include "BkSpan.h"
+#include "BkString.h"
 
 namespace Bk
 {
+	struct Arena;
+
 	using FileHandle = uintptr_t;
 
+	constexpr size_t FileUnbufferedAlignment = BK_KILOBYTES(4);
+
 	enum class FileAccess : uint8
 	{
 		Read = (1 << 0),
 		Write = (1 << 1),
 		Append = (1 << 2),
+		Unbuffered = (1 << 3), // Bypass the OS page cache, transfers must be aligned to FileUnbufferedAlignment
 	};
 
 	BK_ENUM_CLASS_FLAGS(FileAccess);
 
+	enum class FileMapFlags : uint8
+	{
+		None = 0,
+		CopyOnWrite = (1 << 0), // Writable private pages, changes are never written back to the file
+		Sequential = (1 << 1),
+		Random = (1 << 2),
+		HugePages = (1 << 3),
+	};
+
+	BK_ENUM_CLASS_FLAGS(FileMapFlags);
+
+	enum class LoadFileFlags : uint8
+	{
+		None = 0,
+		NullTerminate = (1 << 0),
+		PadTail = (1 << 1), // Zeroed padding past the end so SIMD parsers can safely overread
+	};
+
+	BK_ENUM_CLASS_FLAGS(LoadFileFlags);
+
+	constexpr size_t LoadFilePadding = 64;
+
+	struct FileInfo
+	{
+		uint64 size;
+		uint64 modifiedTime; // Nanoseconds since the Unix epoch
+		bool exists;
+		bool directory;
+	};
+
+	// Write without Append creates or truncates the file
 	FileHandle OpenFile(const char* path, FileAccess access);
 	void CloseFile(FileHandle handle);
 
+	bool RemoveFile(const char* path);
+
+	// Replaces the destination if it exists
+	bool RenameFile(const char* oldPath, const char* newPath);
+
 	size_t ReadFile(FileHandle handle, TSpan<uint8> buffer);
 	size_t WriteFile(FileHandle handle, TSpan<uint8> buffer);
 
+	// Positional variants leave the file cursor alone (except on Windows), so a handle can be shared across threads
+	size_t ReadFileAt(FileHandle handle, uint64 offset, TSpan<uint8> buffer);
+	size_t WriteFileAt(FileHandle handle, uint64 offset, TSpan<uint8> buffer);
+
+	// Scatter/gather a contiguous range of the file from/to multiple buffers
+	size_t ReadFileVectored(FileHandle handle, uint64 offset, TSpan<TSpan<uint8>> buffers);
+	size_t WriteFileVectored(FileHandle handle, uint64 offset, TSpan<TSpan<uint8>> buffers);
+
 	size_t GetFileSize(FileHandle handle);
+	bool SetFileSize(FileHandle handle, uint64 size);
+
+	// Reserves contiguous space without changing the file size, so a large file written afterwards doesn't fragment
+	bool PreallocateFile(FileHandle handle, uint64 size);
+
+	// Flushes written data to the device, metadata such as the modification time is only included when requested
+	bool SyncFile(FileHandle handle, bool metadata = false);
+
+	// Queried by path without opening the file, symbolic links are followed
+	bool GetFileInfo(const char* path, FileInfo& info);
+
+	// Returns how many of the paths exist, infos must be at least as long as paths
+	size_t GetFileInfos(TSpan<const char*> paths, TSpan<FileInfo> infos);
+
+	// Reads the whole file with a single arena allocation, padding isn't included in the returned length
+	TSpan<uint8> LoadFile(Arena& arena, const char* path, LoadFileFlags flags = LoadFileFlags::None);
+	String LoadFileString(Arena& arena, const char* path, LoadFileFlags flags = LoadFileFlags::NullTerminate);
+
+	// Maps the whole file into memory, the mapping stays valid after the handle is closed
+	TSpan<uint8> MapFile(FileHandle handle, FileMapFlags flags = FileMapFlags::None);
+	void UnmapFile(TSpan<uint8> mapping);
+
+	// Writes go to a temporary file next to the target, which only replaces it on commit. After a crash the target
+	// holds either the old or the new contents, never a mix
+	struct AtomicFile
+	{
+		bool Begin(Arena* arena, const char* path, uint64 preallocateSize = 0);
+
+		// Without durable the replace is still atomic, but may be lost on power failure
+		bool Commit(bool durable = true);
+		void Abort();
+
+		FileHandle handle;
+		const char* path;
+		const char* tempPath;
+		bool preallocated;
+	};
+
+	// Commits several files with one directory sync per directory, rather than one per file
+	bool CommitAtomicFiles(TSpan<AtomicFile> files, bool durable = true);
 }
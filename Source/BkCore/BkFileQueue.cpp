@@ -0,0 +1,660 @@
+#include "BkFileQueue.h"
+
+#include "BkArena.h"
+#include "BkMemory.h"
+
+#if defined(BK_PLATFORM_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#if defined(BK_PLATFORM_LINUX)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(BK_PLATFORM_EMSCRIPTEN) && !defined(__EMSCRIPTEN_PTHREADS__)
+// No threads to run workers on, requests complete as they are submitted
+#define BK_FILE_QUEUE_SYNCHRONOUS
+#endif
+
+namespace Bk
+{
+	struct FileQueueRequest
+	{
+		FileHandle handle;
+		uint64 offset;
+		TSpan<uint8> buffer;
+		uint64 userData;
+		bool write;
+		size_t transferred; // io_uring only, a request is resubmitted until it's complete
+	};
+
+	struct FileQueueState
+	{
+#if defined(BK_PLATFORM_LINUX)
+		int ringHandle;
+		uint32 ringPending;
+
+		uint8* sqRing;
+		size_t sqRingSize;
+		uint8* cqRing;
+		size_t cqRingSize;
+		io_uring_sqe* sqes;
+		size_t sqesSize;
+
+		uint32* sqHead;
+		uint32* sqTail;
+		uint32* sqMask;
+		uint32* sqArray;
+		uint32* cqHead;
+		uint32* cqTail;
+		uint32* cqMask;
+		io_uring_cqe* cqes;
+
+		// Requests in flight in the ring, indexed by the user data of their submissions
+		uint32* freeSlots;
+		uint32 freeSlotCount;
+#endif
+
+		// Worker fallback, both rings hold up to depth entries so they can never overflow. With io_uring requests
+		// holds the in-flight slots instead
+		FileQueueRequest* requests;
+		uint32 requestHead;
+		uint32 requestCount;
+
+		FileCompletion* completions;
+		uint32 completionHead;
+		uint32 completionCount;
+
+		uint32 capacity;
+		uint32 workerCount;
+		bool stopping;
+
+#if defined(BK_PLATFORM_WINDOWS)
+		SRWLOCK lock;
+		CONDITION_VARIABLE requestReady;
+		CONDITION_VARIABLE completionReady;
+		HANDLE* workers;
+#elif !defined(BK_FILE_QUEUE_SYNCHRONOUS)
+		pthread_mutex_t lock;
+		pthread_cond_t requestReady;
+		pthread_cond_t completionReady;
+		pthread_t* workers;
+#endif
+	};
+
+	static size_t FileQueueTransfer(const FileQueueRequest& request, bool& success)
+	{
+		size_t bytesTransferred = request.write
+			? WriteFileAt(request.handle, request.offset, request.buffer)
+			: ReadFileAt(request.handle, request.offset, request.buffer);
+
+		// Reads can legitimately come up short at the end of the file
+		success = !request.write || bytesTransferred == request.buffer.length;
+
+		return bytesTransferred;
+	}
+
+	static void PushFileCompletion(FileQueueState* state, const FileQueueRequest& request, size_t bytesTransferred, bool success)
+	{
+		BK_ASSERT(state->completionCount < state->capacity);
+
+		uint32 completionIdx = (state->completionHead + state->completionCount) % state->capacity;
+		state->completions[completionIdx] = { .userData = request.userData, .bytesTransferred = bytesTransferred, .success = success };
+		state->completionCount += 1;
+	}
+
+	static size_t PopFileCompletions(FileQueueState* state, TSpan<FileCompletion> completions)
+	{
+		size_t count = BK_MIN(completions.length, size_t(state->completionCount));
+		for (size_t idx = 0; idx < count; ++idx)
+		{
+			completions.data[idx] = state->completions[state->completionHead];
+
+			state->completionHead = (state->completionHead + 1) % state->capacity;
+			state->completionCount -= 1;
+		}
+
+		return count;
+	}
+
+#if !defined(BK_FILE_QUEUE_SYNCHRONOUS)
+	static void LockFileQueue(FileQueueState* state)
+	{
+#if defined(BK_PLATFORM_WINDOWS)
+		AcquireSRWLockExclusive(&state->lock);
+#else
+		pthread_mutex_lock(&state->lock);
+#endif
+	}
+
+	static void UnlockFileQueue(FileQueueState* state)
+	{
+#if defined(BK_PLATFORM_WINDOWS)
+		ReleaseSRWLockExclusive(&state->lock);
+#else
+		pthread_mutex_unlock(&state->lock);
+#endif
+	}
+
+	static void RunFileQueueWorker(FileQueueState* state)
+	{
+		LockFileQueue(state);
+
+		while (true)
+		{
+			while (!state->stopping && state->requestCount == 0)
+			{
+#if defined(BK_PLATFORM_WINDOWS)
+				SleepConditionVariableSRW(&state->requestReady, &state->lock, INFINITE, 0);
+#else
+				pthread_cond_wait(&state->requestReady, &state->lock);
+#endif
+			}
+
+			if (state->stopping)
+			{
+				break;
+			}
+
+			FileQueueRequest request = state->requests[state->requestHead];
+			state->requestHead = (state->requestHead + 1) % state->capacity;
+			state->requestCount -= 1;
+
+			UnlockFileQueue(state);
+
+			bool success;
+			size_t bytesTransferred = FileQueueTransfer(request, success);
+
+			LockFileQueue(state);
+
+			PushFileCompletion(state, request, bytesTransferred, success);
+
+#if defined(BK_PLATFORM_WINDOWS)
+			WakeConditionVariable(&state->completionReady);
+#else
+			pthread_cond_signal(&state->completionReady);
+#endif
+		}
+
+		UnlockFileQueue(state);
+	}
+
+#if defined(BK_PLATFORM_WINDOWS)
+	static DWORD WINAPI FileQueueWorker(void* userData)
+	{
+		RunFileQueueWorker(static_cast<FileQueueState*>(userData));
+		return 0;
+	}
+#else
+	static void* FileQueueWorker(void* userData)
+	{
+		RunFileQueueWorker(static_cast<FileQueueState*>(userData));
+		return nullptr;
+	}
+#endif
+#endif
+
+#if defined(BK_PLATFORM_LINUX)
+	static bool InitializeIoUring(FileQueueState* state, uint32 depth)
+	{
+		io_uring_params params = {};
+
+		int ringHandle = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+		if (ringHandle < 0)
+		{
+			// Not supported by the kernel or blocked by the sandbox
+			return false;
+		}
+
+		state->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32);
+		state->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		state->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+		const bool singleMapping = params.features & IORING_FEAT_SINGLE_MMAP;
+		if (singleMapping)
+		{
+			state->sqRingSize = BK_MAX(state->sqRingSize, state->cqRingSize);
+			state->cqRingSize = state->sqRingSize;
+		}
+
+		void* sqRing = mmap(nullptr, state->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringHandle, IORING_OFF_SQ_RING);
+		void* cqRing = singleMapping ? sqRing : mmap(nullptr, state->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringHandle, IORING_OFF_CQ_RING);
+		void* sqes = mmap(nullptr, state->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringHandle, IORING_OFF_SQES);
+
+		if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED)
+		{
+			if (sqes != MAP_FAILED)
+			{
+				munmap(sqes, state->sqesSize);
+			}
+
+			if (cqRing != MAP_FAILED && !singleMapping)
+			{
+				munmap(cqRing, state->cqRingSize);
+			}
+
+			if (sqRing != MAP_FAILED)
+			{
+				munmap(sqRing, state->sqRingSize);
+			}
+
+			close(ringHandle);
+			return false;
+		}
+
+		// Setup works from 5.1, but plain reads and writes only arrived in 5.6 along with the probe
+		bool supported = false;
+
+		alignas(io_uring_probe) uint8 probeBuffer[sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op)] = {};
+		io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(probeBuffer);
+
+		if (syscall(__NR_io_uring_register, ringHandle, IORING_REGISTER_PROBE, probe, 256) == 0)
+		{
+			supported = probe->last_op >= IORING_OP_WRITE && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) &&
+				(probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+		}
+
+		if (!supported)
+		{
+			munmap(sqes, state->sqesSize);
+
+			if (!singleMapping)
+			{
+				munmap(cqRing, state->cqRingSize);
+			}
+
+			munmap(sqRing, state->sqRingSize);
+			close(ringHandle);
+			return false;
+		}
+
+		state->ringHandle = ringHandle;
+		state->sqRing = static_cast<uint8*>(sqRing);
+		state->cqRing = static_cast<uint8*>(cqRing);
+		state->sqes = static_cast<io_uring_sqe*>(sqes);
+
+		state->sqHead = reinterpret_cast<uint32*>(state->sqRing + params.sq_off.head);
+		state->sqTail = reinterpret_cast<uint32*>(state->sqRing + params.sq_off.tail);
+		state->sqMask = reinterpret_cast<uint32*>(state->sqRing + params.sq_off.ring_mask);
+		state->sqArray = reinterpret_cast<uint32*>(state->sqRing + params.sq_off.array);
+		state->cqHead = reinterpret_cast<uint32*>(state->cqRing + params.cq_off.head);
+		state->cqTail = reinterpret_cast<uint32*>(state->cqRing + params.cq_off.tail);
+		state->cqMask = reinterpret_cast<uint32*>(state->cqRing + params.cq_off.ring_mask);
+		state->cqes = reinterpret_cast<io_uring_cqe*>(state->cqRing + params.cq_off.cqes);
+
+		return true;
+	}
+
+	static void ShutdownIoUring(FileQueueState* state)
+	{
+		munmap(state->sqes, state->sqesSize);
+
+		if (state->cqRing != state->sqRing)
+		{
+			munmap(state->cqRing, state->cqRingSize);
+		}
+
+		munmap(state->sqRing, state->sqRingSize);
+		close(state->ringHandle);
+
+		state->ringHandle = -1;
+	}
+
+	// Submits what's left of the request in the slot, also used to continue short transfers
+	static void SubmitIoUring(FileQueueState* state, uint32 slotIdx)
+	{
+		const FileQueueRequest& request = state->requests[slotIdx];
+
+		// Only this thread produces submissions, so the tail can be read plainly
+		uint32 tail = *state->sqTail;
+		uint32 index = tail & *state->sqMask;
+
+		io_uring_sqe& sqe = state->sqes[index];
+		MemoryZero(&sqe, sizeof(sqe));
+
+		sqe.opcode = request.write ? IORING_OP_WRITE : IORING_OP_READ;
+		sqe.fd = static_cast<int32>(request.handle);
+		sqe.off = request.offset + request.transferred;
+		sqe.addr = reinterpret_cast<uint64>(request.buffer.data + request.transferred);
+		sqe.len = static_cast<uint32>(BK_MIN(request.buffer.length - request.transferred, size_t(UINT32_MAX)));
+		sqe.user_data = slotIdx;
+
+		state->sqArray[index] = index;
+		__atomic_store_n(state->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+		state->ringPending += 1;
+	}
+
+	static bool EnterIoUring(FileQueueState* state, uint32 minComplete)
+	{
+		uint32 flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+
+		while (state->ringPending > 0 || minComplete > 0)
+		{
+			long result = syscall(__NR_io_uring_enter, state->ringHandle, state->ringPending, minComplete, flags, nullptr, 0);
+			if (result < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+
+				return false;
+			}
+
+			state->ringPending -= static_cast<uint32>(result);
+
+			if (minComplete > 0)
+			{
+				break;
+			}
+		}
+
+		return true;
+	}
+
+	static size_t PopIoUringCompletions(FileQueueState* state, TSpan<FileCompletion> completions)
+	{
+		uint32 head = *state->cqHead;
+		uint32 tail = __atomic_load_n(state->cqTail, __ATOMIC_ACQUIRE);
+
+		size_t count = 0;
+		for (; head != tail && count < completions.length; head += 1)
+		{
+			const io_uring_cqe& cqe = state->cqes[head & *state->cqMask];
+
+			uint32 slotIdx = static_cast<uint32>(cqe.user_data);
+			FileQueueRequest& request = state->requests[slotIdx];
+
+			// Short transfers continue where they stopped, like the loops behind the worker fallback. Only reads can
+			// end early, at the end of the file
+			if (cqe.res > 0)
+			{
+				request.transferred += static_cast<size_t>(cqe.res);
+				if (request.transferred < request.buffer.length)
+				{
+					SubmitIoUring(state, slotIdx);
+					continue;
+				}
+			}
+
+			FileCompletion& completion = completions.data[count];
+			completion.userData = request.userData;
+			completion.bytesTransferred = request.transferred;
+			completion.success = cqe.res >= 0 && (!request.write || request.transferred == request.buffer.length);
+
+			state->freeSlots[state->freeSlotCount] = slotIdx;
+			state->freeSlotCount += 1;
+			count += 1;
+		}
+
+		__atomic_store_n(state->cqHead, head, __ATOMIC_RELEASE);
+
+		return count;
+	}
+#endif
+
+	bool FileQueue::Initialize(Arena* arena, uint32 queueDepth, uint32 workerCount)
+	{
+		BK_ASSERT(queueDepth > 0);
+
+		state = arena->PushZeroed<FileQueueState>();
+		depth = queueDepth;
+		inFlight = 0;
+
+#if defined(BK_PLATFORM_LINUX)
+		state->ringHandle = -1;
+		if (InitializeIoUring(state, queueDepth))
+		{
+			state->requests = arena->Push<FileQueueRequest>(queueDepth);
+			state->freeSlots = arena->Push<uint32>(queueDepth);
+			state->freeSlotCount = queueDepth;
+
+			for (uint32 slotIdx = 0; slotIdx < queueDepth; ++slotIdx)
+			{
+				state->freeSlots[slotIdx] = queueDepth - 1 - slotIdx;
+			}
+
+			return true;
+		}
+#endif
+
+		state->capacity = queueDepth;
+		state->requests = arena->Push<FileQueueRequest>(queueDepth);
+		state->completions = arena->Push<FileCompletion>(queueDepth);
+
+#if !defined(BK_FILE_QUEUE_SYNCHRONOUS)
+		state->workerCount = BK_MAX(workerCount, 1u);
+
+#if defined(BK_PLATFORM_WINDOWS)
+		InitializeSRWLock(&state->lock);
+		InitializeConditionVariable(&state->requestReady);
+		InitializeConditionVariable(&state->completionReady);
+
+		state->workers = arena->PushZeroed<HANDLE>(state->workerCount);
+		for (uint32 workerIdx = 0; workerIdx < state->workerCount; ++workerIdx)
+		{
+			state->workers[workerIdx] = CreateThread(nullptr, 0, FileQueueWorker, state, 0, nullptr);
+			if (!state->workers[workerIdx])
+			{
+				state->workerCount = workerIdx;
+				break;
+			}
+		}
+#else
+		pthread_mutex_init(&state->lock, nullptr);
+		pthread_cond_init(&state->requestReady, nullptr);
+		pthread_cond_init(&state->completionReady, nullptr);
+
+		state->workers = arena->PushZeroed<pthread_t>(state->workerCount);
+		for (uint32 workerIdx = 0; workerIdx < state->workerCount; ++workerIdx)
+		{
+			if (pthread_create(&state->workers[workerIdx], nullptr, FileQueueWorker, state) != 0)
+			{
+				state->workerCount = workerIdx;
+				break;
+			}
+		}
+#endif
+
+		if (state->workerCount == 0)
+		{
+			Shutdown();
+			return false;
+		}
+#endif
+
+		return true;
+	}
+
+	void FileQueue::Shutdown()
+	{
+		if (!state)
+		{
+			return;
+		}
+
+		// The kernel or the workers still reference in-flight buffers, so requests are finished before tearing down
+		while (inFlight > 0)
+		{
+			FileCompletion completions[32];
+			Wait(TSpan(completions), 1);
+		}
+
+#if defined(BK_PLATFORM_LINUX)
+		if (state->ringHandle >= 0)
+		{
+			ShutdownIoUring(state);
+			state = nullptr;
+			return;
+		}
+#endif
+
+#if !defined(BK_FILE_QUEUE_SYNCHRONOUS)
+		LockFileQueue(state);
+		state->stopping = true;
+		UnlockFileQueue(state);
+
+#if defined(BK_PLATFORM_WINDOWS)
+		WakeAllConditionVariable(&state->requestReady);
+
+		for (uint32 workerIdx = 0; workerIdx < state->workerCount; ++workerIdx)
+		{
+			WaitForSingleObject(state->workers[workerIdx], INFINITE);
+			CloseHandle(state->workers[workerIdx]);
+		}
+#else
+		pthread_cond_broadcast(&state->requestReady);
+
+		for (uint32 workerIdx = 0; workerIdx < state->workerCount; ++workerIdx)
+		{
+			pthread_join(state->workers[workerIdx], nullptr);
+		}
+
+		pthread_cond_destroy(&state->completionReady);
+		pthread_cond_destroy(&state->requestReady);
+		pthread_mutex_destroy(&state->lock);
+#endif
+#endif
+
+		state = nullptr;
+	}
+
+	static bool SubmitFileRequest(FileQueue& queue, const FileQueueRequest& request)
+	{
+		if (!queue.state || !request.handle || queue.inFlight >= queue.depth)
+		{
+			return false;
+		}
+
+		FileQueueState* state = queue.state;
+		queue.inFlight += 1;
+
+#if defined(BK_PLATFORM_LINUX)
+		if (state->ringHandle >= 0)
+		{
+			// In-flight requests are capped at depth, so there's always a free slot and room in the submission ring
+			state->freeSlotCount -= 1;
+			uint32 slotIdx = state->freeSlots[state->freeSlotCount];
+
+			state->requests[slotIdx] = request;
+			SubmitIoUring(state, slotIdx);
+			return true;
+		}
+#endif
+
+#if defined(BK_FILE_QUEUE_SYNCHRONOUS)
+		bool success;
+		size_t bytesTransferred = FileQueueTransfer(request, success);
+
+		PushFileCompletion(state, request, bytesTransferred, success);
+#else
+		LockFileQueue(state);
+
+		uint32 requestIdx = (state->requestHead + state->requestCount) % state->capacity;
+		state->requests[requestIdx] = request;
+		state->requestCount += 1;
+
+		UnlockFileQueue(state);
+
+#if defined(BK_PLATFORM_WINDOWS)
+		WakeConditionVariable(&state->requestReady);
+#else
+		pthread_cond_signal(&state->requestReady);
+#endif
+#endif
+
+		return true;
+	}
+
+	bool FileQueue::SubmitRead(FileHandle handle, uint64 offset, TSpan<uint8> buffer, uint64 userData)
+	{
+		return SubmitFileRequest(*this, { .handle = handle, .offset = offset, .buffer = buffer, .userData = userData, .write = false });
+	}
+
+	bool FileQueue::SubmitWrite(FileHandle handle, uint64 offset, TSpan<uint8> buffer, uint64 userData)
+	{
+		return SubmitFileRequest(*this, { .handle = handle, .offset = offset, .buffer = buffer, .userData = userData, .write = true });
+	}
+
+	void FileQueue::Flush()
+	{
+#if defined(BK_PLATFORM_LINUX)
+		if (state && state->ringHandle >= 0)
+		{
+			EnterIoUring(state, 0);
+		}
+#endif
+	}
+
+	size_t FileQueue::Poll(TSpan<FileCompletion> completions)
+	{
+		return Wait(completions, 0);
+	}
+
+	size_t FileQueue::Wait(TSpan<FileCompletion> completions, size_t minCount)
+	{
+		if (!state)
+		{
+			return 0;
+		}
+
+		// Never wait on more than can actually complete
+		minCount = BK_MIN(minCount, BK_MIN(completions.length, size_t(inFlight)));
+
+		size_t count = 0;
+
+#if defined(BK_PLATFORM_LINUX)
+		if (state->ringHandle >= 0)
+		{
+			EnterIoUring(state, 0);
+
+			count = PopIoUringCompletions(state, completions);
+			while (count < minCount)
+			{
+				if (!EnterIoUring(state, static_cast<uint32>(minCount - count)))
+				{
+					break;
+				}
+
+				count += PopIoUringCompletions(state, TSpan(completions.data + count, completions.length - count));
+			}
+
+			// Hand over the remainders of short transfers
+			EnterIoUring(state, 0);
+
+			inFlight -= static_cast<uint32>(count);
+			return count;
+		}
+#endif
+
+#if defined(BK_FILE_QUEUE_SYNCHRONOUS)
+		count = PopFileCompletions(state, completions);
+#else
+		LockFileQueue(state);
+
+		while (state->completionCount < minCount)
+		{
+#if defined(BK_PLATFORM_WINDOWS)
+			SleepConditionVariableSRW(&state->completionReady, &state->lock, INFINITE, 0);
+#else
+			pthread_cond_wait(&state->completionReady, &state->lock);
+#endif
+		}
+
+		count = PopFileCompletions(state, completions);
+
+		UnlockFileQueue(state);
+#endif
+
+		inFlight -= static_cast<uint32>(count);
+		return count;
+	}
+}
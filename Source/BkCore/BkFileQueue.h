@@ -0,0 +1,40 @@
+#pragma once
+
+#include "BkCore.h"
+#include "BkFile.h"
+#include "BkSpan.h"
+
+namespace Bk
+{
+	struct Arena;
+	struct FileQueueState;
+
+	struct FileCompletion
+	{
+		uint64 userData;
+		size_t bytesTransferred; // Can be short of the requested size, e.g. when reading past the end of the file
+		bool success;
+	};
+
+	// Asynchronous positional reads and writes, backed by io_uring on Linux and by worker threads elsewhere.
+	// Buffers must stay alive until their request completes. Meant to be used from a single thread
+	struct FileQueue
+	{
+		bool Initialize(Arena* arena, uint32 depth, uint32 workerCount = 4);
+		void Shutdown();
+
+		// Fails if depth requests are already in flight
+		bool SubmitRead(FileHandle handle, uint64 offset, TSpan<uint8> buffer, uint64 userData = 0);
+		bool SubmitWrite(FileHandle handle, uint64 offset, TSpan<uint8> buffer, uint64 userData = 0);
+
+		// Hands queued requests to the kernel or workers, also done implicitly by Poll and Wait
+		void Flush();
+
+		size_t Poll(TSpan<FileCompletion> completions);
+		size_t Wait(TSpan<FileCompletion> completions, size_t minCount = 1);
+
+		FileQueueState* state;
+		uint32 depth;
+		uint32 inFlight;
+	};
+}
@@ -0,0 +1,258 @@
+#include "BkFileStream.h"
+
+#include "BkArena.h"
+
+namespace Bk
+{
+	void FileWriter::Initialize(Arena* arena, FileHandle fileHandle, size_t bufferSize, bool unbufferedWrites)
+	{
+		handle = fileHandle;
+		unbuffered = unbufferedWrites;
+
+		capacity = unbuffered ? AlignUp(bufferSize, FileUnbufferedAlignment) : bufferSize;
+		buffer = arena->Push(capacity, unbuffered ? FileUnbufferedAlignment : Arena::DefaultAlignment);
+		length = 0;
+		bytesFlushed = 0;
+	}
+
+	static bool FlushFileWriter(FileWriter& writer, size_t flushLength)
+	{
+		if (flushLength == 0)
+		{
+			return true;
+		}
+
+		size_t bytesWritten = WriteFile(writer.handle, TSpan(writer.buffer, flushLength));
+		writer.bytesFlushed += bytesWritten;
+
+		// Keep whatever wasn't written at the front of the buffer
+		writer.length -= bytesWritten;
+		MemoryMove(writer.buffer, writer.buffer + bytesWritten, writer.length);
+
+		return bytesWritten == flushLength;
+	}
+
+	bool FileWriter::Write(TSpan<uint8> data)
+	{
+		while (data.length > 0)
+		{
+			if (length == capacity && !Flush())
+			{
+				return false;
+			}
+
+			if (!unbuffered && length == 0 && data.length >= capacity)
+			{
+				// Too large to be worth buffering
+				size_t bytesWritten = WriteFile(handle, data);
+				bytesFlushed += bytesWritten;
+
+				return bytesWritten == data.length;
+			}
+
+			size_t copySize = BK_MIN(capacity - length, data.length);
+			MemoryCopy(buffer + length, data.data, copySize);
+
+			length += copySize;
+			data = TSpan(data.data + copySize, data.length - copySize);
+		}
+
+		return true;
+	}
+
+	bool FileWriter::Write(String string)
+	{
+		return Write(TSpan(reinterpret_cast<uint8*>(const_cast<char*>(string.data)), string.length));
+	}
+
+	bool FileWriter::Writef(const char* format, ...)
+	{
+		va_list args;
+		va_start(args, format);
+		bool result = Writev(format, args);
+		va_end(args);
+
+		return result;
+	}
+
+	bool FileWriter::Writev(const char* format, va_list args)
+	{
+		// Format straight into the buffer, flushing and retrying once if it doesn't fit
+		for (int32 attempt = 0; attempt < 2; ++attempt)
+		{
+			va_list argsCopy;
+			va_copy(argsCopy, args);
+
+			size_t availableSize = capacity - length;
+			int32 result = StringPrintv(reinterpret_cast<char*>(buffer + length), availableSize, format, argsCopy);
+			va_end(argsCopy);
+
+			if (result < 0)
+			{
+				return false;
+			}
+
+			// vsnprintf needs room for the terminator it always writes
+			if (static_cast<size_t>(result) < availableSize)
+			{
+				length += static_cast<size_t>(result);
+				return true;
+			}
+
+			if (attempt > 0 || !Flush())
+			{
+				break;
+			}
+		}
+
+		return false;
+	}
+
+	bool FileWriter::Flush()
+	{
+		// Unbuffered writes must be whole blocks, the partial tail stays buffered until Finish
+		size_t flushLength = unbuffered ? length - length % FileUnbufferedAlignment : length;
+		return FlushFileWriter(*this, flushLength);
+	}
+
+	bool FileWriter::Finish()
+	{
+		if (!Flush())
+		{
+			return false;
+		}
+
+		if (!unbuffered || length == 0)
+		{
+			return true;
+		}
+
+		// Pad out the last block, then trim the file back to the bytes actually written
+		uint64 fileSize = bytesFlushed + length;
+
+		size_t paddedLength = AlignUp(length, FileUnbufferedAlignment);
+		MemoryZero(buffer + length, paddedLength - length);
+
+		if (!FlushFileWriter(*this, paddedLength))
+		{
+			return false;
+		}
+
+		length = 0;
+		return SetFileSize(handle, fileSize);
+	}
+
+	void FileReader::Initialize(Arena* arena, FileHandle fileHandle, size_t bufferSize, bool unbufferedReads)
+	{
+		handle = fileHandle;
+		unbuffered = unbufferedReads;
+
+		capacity = unbuffered ? AlignUp(bufferSize, FileUnbufferedAlignment) : bufferSize;
+		buffer = arena->Push(capacity, unbuffered ? FileUnbufferedAlignment : Arena::DefaultAlignment);
+		position = 0;
+		length = 0;
+		endOfFile = false;
+	}
+
+	static bool RefillFileReader(FileReader& reader)
+	{
+		if (reader.endOfFile)
+		{
+			return false;
+		}
+
+		// Unbuffered reads must land on an aligned address, so the leftover bytes are moved to end right where the
+		// next aligned read starts
+		size_t leftover = reader.length - reader.position;
+		size_t readStart = reader.unbuffered ? AlignUp(leftover, FileUnbufferedAlignment) : leftover;
+
+		if (readStart >= reader.capacity)
+		{
+			return false;
+		}
+
+		MemoryMove(reader.buffer + readStart - leftover, reader.buffer + reader.position, leftover);
+		reader.position = readStart - leftover;
+
+		size_t readSize = reader.capacity - readStart;
+		size_t bytesRead = ReadFile(reader.handle, TSpan(reader.buffer + readStart, readSize));
+
+		reader.length = readStart + bytesRead;
+		reader.endOfFile = bytesRead < readSize;
+
+		return bytesRead > 0;
+	}
+
+	size_t FileReader::Read(TSpan<uint8> data)
+	{
+		size_t totalBytesRead = 0;
+
+		while (totalBytesRead < data.length)
+		{
+			if (position == length)
+			{
+				if (!unbuffered && !endOfFile && data.length - totalBytesRead >= capacity)
+				{
+					// Too large to be worth buffering
+					size_t bytesRead = ReadFile(handle, TSpan(data.data + totalBytesRead, data.length - totalBytesRead));
+					endOfFile = totalBytesRead + bytesRead < data.length;
+
+					return totalBytesRead + bytesRead;
+				}
+
+				if (!RefillFileReader(*this))
+				{
+					break;
+				}
+			}
+
+			size_t copySize = BK_MIN(length - position, data.length - totalBytesRead);
+			MemoryCopy(data.data + totalBytesRead, buffer + position, copySize);
+
+			position += copySize;
+			totalBytesRead += copySize;
+		}
+
+		return totalBytesRead;
+	}
+
+	bool FileReader::ReadLine(String& line)
+	{
+		while (true)
+		{
+			String pending(reinterpret_cast<const char*>(buffer + position), length - position);
+
+			size_t lineEnd = pending.Find('\n');
+			size_t lineLength = lineEnd + 1;
+
+			if (lineEnd == SIZE_MAX)
+			{
+				if (RefillFileReader(*this))
+				{
+					continue;
+				}
+
+				// Refilling can move the pending bytes even when nothing more was read
+				pending = String(reinterpret_cast<const char*>(buffer + position), length - position);
+				if (pending.length == 0)
+				{
+					return false;
+				}
+
+				// Last line without a line ending, or a line that doesn't fit in the buffer
+				lineEnd = pending.length;
+				lineLength = pending.length;
+			}
+
+			position += lineLength;
+
+			line = pending.Slice(0, lineEnd);
+			if (line.length > 0 && line.data[line.length - 1] == '\r')
+			{
+				line.length -= 1;
+			}
+
+			return true;
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "BkCore.h"
+#include "BkFile.h"
+#include "BkMemory.h"
+#include "BkSpan.h"
+#include "BkString.h"
+
+#include <stdarg.h>
+
+namespace Bk
+{
+	struct Arena;
+
+	// Buffers writes so small records don't each cost a syscall. Handles opened with FileAccess::Unbuffered are
+	// written from the start of the file in aligned blocks, with the final partial block written by Finish
+	struct FileWriter
+	{
+		void Initialize(Arena* arena, FileHandle fileHandle, size_t bufferSize = BK_KILOBYTES(64), bool unbuffered = false);
+
+		bool Write(TSpan<uint8> data);
+		bool Write(String string);
+		bool Writef(const char* format, ...);
+		bool Writev(const char* format, va_list args);
+
+		bool Flush();
+		bool Finish();
+
+		FileHandle handle;
+		uint8* buffer;
+		size_t capacity;
+		size_t length;
+		uint64 bytesFlushed;
+		bool unbuffered;
+	};
+
+	// Reads through a large buffer, lines are returned as views into it and stay valid until the next read
+	struct FileReader
+	{
+		void Initialize(Arena* arena, FileHandle fileHandle, size_t bufferSize = BK_KILOBYTES(64), bool unbuffered = false);
+
+		size_t Read(TSpan<uint8> data);
+
+		// Strips the line ending, lines longer than the buffer are returned in buffer-sized pieces
+		bool ReadLine(String& line);
+
+		FileHandle handle;
+		uint8* buffer;
+		size_t capacity;
+		size_t position;
+		size_t length;
+		bool endOfFile;
+		bool unbuffered;
+	};
+}
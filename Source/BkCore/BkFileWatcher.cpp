@@ -0,0 +1,275 @@
+#include "BkFileWatcher.h"
+
+#include "BkArena.h"
+#include "BkFile.h"
+#include "BkMemory.h"
+
+#if defined(BK_PLATFORM_LINUX)
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace Bk
+{
+	struct FileWatch
+	{
+		String path;
+		String name; // Last component of path, null terminated
+		uint32 nameHash;
+		int32 directoryWatch;
+		FileInfo info;
+		uint64 changeTime; // 0 while no change is pending
+	};
+
+	struct FileWatcherState
+	{
+		FileWatch* watches;
+		uint32 watchCount;
+		uint32 maxWatches;
+
+		Arena* arena;
+		uint64 settleTime;
+		uint64 pollInterval;
+		uint64 lastPollTime;
+
+#if defined(BK_PLATFORM_LINUX)
+		int notifyHandle; // -1 when falling back to polling
+#endif
+	};
+
+#if defined(BK_PLATFORM_LINUX)
+	// Files are replaced by renames often enough that watching them directly would lose track of them, so their
+	// directories are watched instead
+	constexpr uint32 FileWatchEvents = IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM |
+		IN_DELETE_SELF | IN_MOVE_SELF;
+
+	static bool WatchFileDirectory(FileWatcherState* state, FileWatch& watch)
+	{
+		size_t directoryLength = watch.path.length - watch.name.length;
+
+		TStringBuffer<1024> directory;
+		if (!directory.Append(directoryLength > 0 ? watch.path.Slice(0, directoryLength) : String("./")))
+		{
+			return false;
+		}
+
+		// Watching the same directory again returns the existing watch descriptor
+		watch.directoryWatch = inotify_add_watch(state->notifyHandle, directory.data, FileWatchEvents);
+		return watch.directoryWatch != -1;
+	}
+
+	static void ReadFileWatchEvents(FileWatcherState* state, uint64 time)
+	{
+		alignas(inotify_event) uint8 buffer[BK_KILOBYTES(4)];
+
+		while (true)
+		{
+			ssize_t bytesRead = read(state->notifyHandle, buffer, sizeof(buffer));
+			if (bytesRead == -1 && errno == EINTR)
+			{
+				continue;
+			}
+
+			if (bytesRead <= 0)
+			{
+				break;
+			}
+
+			for (size_t offset = 0; offset < static_cast<size_t>(bytesRead);)
+			{
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+				offset += sizeof(inotify_event) + event->len;
+
+				if (event->mask & IN_Q_OVERFLOW)
+				{
+					// Events were dropped, treat everything as changed
+					for (uint32 watchIdx = 0; watchIdx < state->watchCount; ++watchIdx)
+					{
+						state->watches[watchIdx].changeTime = time;
+					}
+
+					continue;
+				}
+
+				if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF))
+				{
+					// The directory is gone or no longer at its path, hand its files over to polling until the watch
+					// can be added again. A moved directory keeps its watch, so drop it to not hear from it anymore
+					if (event->mask & IN_MOVE_SELF)
+					{
+						inotify_rm_watch(state->notifyHandle, event->wd);
+					}
+
+					for (uint32 watchIdx = 0; watchIdx < state->watchCount; ++watchIdx)
+					{
+						FileWatch& watch = state->watches[watchIdx];
+						if (watch.directoryWatch == event->wd)
+						{
+							watch.directoryWatch = -1;
+							watch.changeTime = time;
+							GetFileInfo(watch.path.data, watch.info);
+						}
+					}
+
+					continue;
+				}
+
+				if (event->len == 0)
+				{
+					continue;
+				}
+
+				String name(event->name);
+				uint32 nameHash = StringHash(name);
+
+				for (uint32 watchIdx = 0; watchIdx < state->watchCount; ++watchIdx)
+				{
+					FileWatch& watch = state->watches[watchIdx];
+					if (watch.directoryWatch == event->wd && watch.nameHash == nameHash && watch.name == name)
+					{
+						watch.changeTime = time;
+					}
+				}
+			}
+		}
+	}
+#endif
+
+	// Covers every watch without a directory watch, i.e. all of them when inotify isn't available. Otherwise those are
+	// watches whose directory didn't exist or went away, which get their directory watch back once it's there again
+	static void PollFileWatches(FileWatcherState* state, uint64 time)
+	{
+		if (time - state->lastPollTime < state->pollInterval)
+		{
+			return;
+		}
+
+		state->lastPollTime = time;
+
+		for (uint32 watchIdx = 0; watchIdx < state->watchCount; ++watchIdx)
+		{
+			FileWatch& watch = state->watches[watchIdx];
+			if (watch.directoryWatch != -1)
+			{
+				continue;
+			}
+
+			FileInfo info;
+			GetFileInfo(watch.path.data, info);
+
+			if (info.exists != watch.info.exists || info.size != watch.info.size || info.modifiedTime != watch.info.modifiedTime)
+			{
+				watch.info = info;
+				watch.changeTime = time;
+			}
+
+#if defined(BK_PLATFORM_LINUX)
+			if (state->notifyHandle != -1)
+			{
+				WatchFileDirectory(state, watch);
+			}
+#endif
+		}
+	}
+
+	bool FileWatcher::Initialize(Arena* arena, uint32 maxWatches, uint32 settleTimeMs, uint32 pollIntervalMs)
+	{
+		state = arena->PushZeroed<FileWatcherState>();
+		state->watches = arena->PushZeroed<FileWatch>(maxWatches);
+		state->maxWatches = maxWatches;
+		state->arena = arena;
+		state->settleTime = settleTimeMs;
+		state->pollInterval = pollIntervalMs;
+
+#if defined(BK_PLATFORM_LINUX)
+		state->notifyHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+
+		return true;
+	}
+
+	void FileWatcher::Shutdown()
+	{
+#if defined(BK_PLATFORM_LINUX)
+		if (state->notifyHandle != -1)
+		{
+			close(state->notifyHandle);
+		}
+#endif
+
+		state = nullptr;
+	}
+
+	bool FileWatcher::Watch(const char* path)
+	{
+		if (state->watchCount == state->maxWatches)
+		{
+			return false;
+		}
+
+		String watchPath(path);
+
+		char* pathData = reinterpret_cast<char*>(state->arena->Push(watchPath.length + 1, 1));
+		MemoryCopy(pathData, watchPath.data, watchPath.length + 1);
+
+		FileWatch& watch = state->watches[state->watchCount];
+		watch.path = String(pathData, watchPath.length);
+		watch.name = watch.path;
+
+		for (size_t charIdx = watch.path.length; charIdx > 0; --charIdx)
+		{
+			if (watch.path[charIdx - 1] == '/' || watch.path[charIdx - 1] == '\\')
+			{
+				watch.name = watch.path.Slice(charIdx);
+				break;
+			}
+		}
+
+		watch.nameHash = StringHash(watch.name);
+		watch.directoryWatch = -1;
+		watch.changeTime = 0;
+
+		GetFileInfo(watch.path.data, watch.info);
+
+#if defined(BK_PLATFORM_LINUX)
+		if (state->notifyHandle != -1 && !WatchFileDirectory(state, watch))
+		{
+			// The directory may not exist yet, polling will still catch the file once it shows up
+			watch.directoryWatch = -1;
+		}
+#endif
+
+		state->watchCount += 1;
+		return true;
+	}
+
+	size_t FileWatcher::Poll(TSpan<String> changedPaths)
+	{
+		uint64 time = GetTimeMs();
+
+#if defined(BK_PLATFORM_LINUX)
+		if (state->notifyHandle != -1)
+		{
+			ReadFileWatchEvents(state, time);
+		}
+#endif
+
+		PollFileWatches(state, time);
+
+		size_t changedCount = 0;
+
+		for (uint32 watchIdx = 0; watchIdx < state->watchCount && changedCount < changedPaths.length; ++watchIdx)
+		{
+			FileWatch& watch = state->watches[watchIdx];
+
+			if (watch.changeTime != 0 && time - watch.changeTime >= state->settleTime)
+			{
+				watch.changeTime = 0;
+				changedPaths.data[changedCount++] = watch.path;
+			}
+		}
+
+		return changedCount;
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "BkCore.h"
+#include "BkSpan.h"
+#include "BkString.h"
+
+namespace Bk
+{
+	struct Arena;
+	struct FileWatcherState;
+
+	// Reports edited files for hot reloading, backed by inotify on Linux and by polling file info elsewhere.
+	// Editors tend to produce bursts of writes, renames and recreates, so a path is only reported once it has been
+	// quiet for the settle time, and only once per burst
+	struct FileWatcher
+	{
+		bool Initialize(Arena* arena, uint32 maxWatches, uint32 settleTimeMs = 100, uint32 pollIntervalMs = 250);
+		void Shutdown();
+
+		// Watches a single file, which doesn't need to exist yet. The path is copied
+		bool Watch(const char* path);
+
+		// Meant to be called once per frame, returned paths are the ones passed to Watch. Changes that don't fit
+		// are returned by the next call
+		size_t Poll(TSpan<String> changedPaths);
+
+		FileWatcherState* state;
+	};
+}
@@ -43,10 +43,10 @@ namespace Bk
 
 		Arena arena;
 
-		TPool<GpuPipeline> pipelines;
-		TPool<GpuBuffer> buffers;
-		TPool<GpuBindingLayout> bindingLayouts;
-		TPool<GpuBindingGroup> bindingGroups;
+		TPagedPool<GpuPipeline> pipelines;
+		TPagedPool<GpuBuffer> buffers;
+		TPagedPool<GpuBindingLayout> bindingLayouts;
+		TPagedPool<GpuBindingGroup> bindingGroups;
 	} gpuContext;
 
 	static WGPUStringView WgpuConvert(String string)
@@ -144,10 +144,12 @@ namespace Bk
 
 	void GpuInitialize()
 	{
-		gpuContext.pipelines.Initialize(&gpuContext.arena, 32);
-		gpuContext.buffers.Initialize(&gpuContext.arena, 32);
-		gpuContext.bindingLayouts.Initialize(&gpuContext.arena, 32);
-		gpuContext.bindingGroups.Initialize(&gpuContext.arena, 32);
+		gpuContext.arena.tag = MemoryTag::Gpu;
+
+		gpuContext.pipelines.Initialize(&gpuContext.arena);
+		gpuContext.buffers.Initialize(&gpuContext.arena);
+		gpuContext.bindingLayouts.Initialize(&gpuContext.arena);
+		gpuContext.bindingGroups.Initialize(&gpuContext.arena);
 
 		gpuContext.instance = wgpuCreateInstance(nullptr);
 		BK_ASSERTF(gpuContext.instance, "Failed to create WebGPU instance");
@@ -333,7 +335,7 @@ namespace Bk
 
 	void DestroyPipeline(uint32 handle)
 	{
-		GpuPipeline* pipeline = gpuContext.pipelines.GetItem(handle);
+		GpuPipeline* pipeline = gpuContext.pipelines.TryGetItem(handle);
 		if (pipeline)
 		{
 			wgpuRenderPipelineRelease(pipeline->handle);
@@ -390,7 +392,7 @@ namespace Bk
 
 	void WriteBuffer(uint32 handle, TSpan<uint8> data, uint64 offset)
 	{
-		GpuBuffer* buffer = gpuContext.buffers.GetItem(handle);
+		GpuBuffer* buffer = gpuContext.buffers.TryGetItem(handle);
 		if (buffer)
 		{
 			wgpuQueueWriteBuffer(gpuContext.queue, buffer->handle, offset, data.data, data.length);
@@ -399,7 +401,7 @@ namespace Bk
 
 	void DestroyBuffer(uint32 handle)
 	{
-		GpuBuffer* buffer = gpuContext.buffers.GetItem(handle);
+		GpuBuffer* buffer = gpuContext.buffers.TryGetItem(handle);
 		if (buffer)
 		{
 			wgpuBufferRelease(buffer->handle);
@@ -446,7 +448,7 @@ namespace Bk
 
 	void DestroyBindingLayout(uint32 handle)
 	{
-		GpuBindingLayout* bindingLayout = gpuContext.bindingLayouts.GetItem(handle);
+		GpuBindingLayout* bindingLayout = gpuContext.bindingLayouts.TryGetItem(handle);
 		if (bindingLayout)
 		{
 			wgpuBindGroupLayoutRelease(bindingLayout->handle);
@@ -471,7 +473,7 @@ namespace Bk
 			const GpuBindingGroupEntry& binding = desc.bindings[bindingIdx];
 
 			bindings[bindingIdx].binding = bindingIdx;
-			if (const GpuBuffer* buffer = gpuContext.buffers.GetItem(binding.buffer))
+			if (const GpuBuffer* buffer = gpuContext.buffers.TryGetItem(binding.buffer))
 			{
 				BK_ASSERT(binding.bufferOffset < buffer->size);
 				bindings[bindingIdx].buffer = buffer->handle;
@@ -494,7 +496,7 @@ namespace Bk
 
 	void DestroyBindingGroup(uint32 handle)
 	{
-		GpuBindingGroup* bindingGroup = gpuContext.bindingGroups.GetItem(handle);
+		GpuBindingGroup* bindingGroup = gpuContext.bindingGroups.TryGetItem(handle);
 		if (bindingGroup)
 		{
 			wgpuBindGroupRelease(bindingGroup->handle);
@@ -576,7 +578,7 @@ namespace Bk
 
 		for (size_t groupIdx = 0; groupIdx < desc.bindingGroups.length; ++groupIdx)
 		{
-			GpuBindingGroup* group = gpuContext.bindingGroups.GetItem(desc.bindingGroups[groupIdx]);
+			GpuBindingGroup* group = gpuContext.bindingGroups.TryGetItem(desc.bindingGroups[groupIdx]);
 			wgpuRenderPassEncoderSetBindGroup(gpuContext.renderPassEncoder, groupIdx, group ? group->handle : nullptr, 0, nullptr);
 		}
 
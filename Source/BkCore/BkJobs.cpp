@@ -0,0 +1,940 @@
+#include "BkJobs.h"
+
+#include "BkArena.h"
+#include "BkFile.h"
+
+#if defined(BK_PLATFORM_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+#if defined(BK_PLATFORM_EMSCRIPTEN)
+#include <emscripten/threading.h>
+#endif
+
+#if defined(BK_PLATFORM_EMSCRIPTEN) && !defined(__EMSCRIPTEN_PTHREADS__)
+// No threads to run workers on, jobs run as they are submitted
+#define BK_JOBS_SYNCHRONOUS
+#endif
+
+#if defined(BK_PLATFORM_LINUX) && (defined(__x86_64__) || defined(__aarch64__))
+// Jobs on worker threads run on fibers, so waiting suspends the job rather than the worker
+#define BK_JOBS_FIBERS
+#include <sys/mman.h>
+#endif
+
+namespace Bk
+{
+	// Chase-Lev deque, the owning worker pushes and pops at the bottom while other workers steal from the top
+	struct alignas(64) JobQueue
+	{
+		int64 top;
+		alignas(64) int64 bottom;
+		Job** jobs;
+		int64 mask;
+		uint32 random; // Victim selection when stealing
+		Arena scratchArena; // Only touched by the owning worker, for jobs run on its thread's own stack
+	};
+
+#if defined(BK_JOBS_FIBERS)
+	struct JobFiber
+	{
+		void* context; // Saved stack pointer while switched out
+		JobFiber* next;
+		JobCounter* waitCounter;
+		uint32 waitValue;
+		uint8* stack; // Includes the guard page
+		size_t stackSize;
+		Arena scratchArena; // Travels with the fiber, so a job resumed on another worker keeps its scratch
+	};
+
+	// What the fiber being switched away from needs, done once its stack is no longer in use
+	enum class JobFiberAction : uint8
+	{
+		None,
+		Free,
+		Wait,
+	};
+
+	struct JobFiberThread
+	{
+		JobFiber* currentFiber; // Null while on the thread's own stack
+		void* threadContext;
+		JobFiber* previousFiber;
+		JobFiberAction previousAction;
+	};
+#endif
+
+	struct JobSystem
+	{
+		JobQueue* queues;
+		uint32 workerCount;
+		bool stopping;
+
+		// Idle workers sleep until the wake epoch moves past the one they saw before their last search
+		uint32 wakeEpoch;
+		uint32 sleeperCount;
+
+#if defined(BK_JOBS_FIBERS)
+		JobFiber* fibers;
+		uint32 fiberCount;
+		uint32 fiberLock; // Guards both fiber lists
+		JobFiber* freeFibers;
+		JobFiber* waitingFibers;
+		uint32 waitingFiberCount;
+#endif
+
+#if defined(BK_PLATFORM_WINDOWS)
+		SRWLOCK lock;
+		CONDITION_VARIABLE wake;
+		HANDLE* workers;
+#elif !defined(BK_JOBS_SYNCHRONOUS)
+		pthread_mutex_t lock;
+		pthread_cond_t wake;
+		pthread_t* workers;
+#endif
+	};
+
+	static JobSystem jobSystem;
+	static thread_local uint32 jobWorkerIndex = UINT32_MAX;
+	static thread_local Arena jobScratchArena = { .tag = MemoryTag::Jobs }; // For threads that aren't workers
+
+#if defined(BK_JOBS_FIBERS)
+	static thread_local JobFiberThread jobFiberThread;
+
+	// Switches the stack pointer along with the callee-saved registers, the rest are saved by the caller anyway.
+	// New fibers return into the trampoline, which calls the function left in the first callee-saved register
+	extern "C" void BkSwitchFiberContext(void** saveContext, void* loadContext);
+	extern "C" void BkFiberTrampoline();
+
+#if defined(__x86_64__)
+	__asm__(
+		".text\n"
+		".globl BkSwitchFiberContext\n"
+		".hidden BkSwitchFiberContext\n"
+		".type BkSwitchFiberContext, @function\n"
+		"BkSwitchFiberContext:\n"
+		"	pushq %rbp\n"
+		"	pushq %rbx\n"
+		"	pushq %r12\n"
+		"	pushq %r13\n"
+		"	pushq %r14\n"
+		"	pushq %r15\n"
+		"	movq %rsp, (%rdi)\n"
+		"	movq %rsi, %rsp\n"
+		"	popq %r15\n"
+		"	popq %r14\n"
+		"	popq %r13\n"
+		"	popq %r12\n"
+		"	popq %rbx\n"
+		"	popq %rbp\n"
+		"	ret\n"
+		".size BkSwitchFiberContext, .-BkSwitchFiberContext\n"
+		".globl BkFiberTrampoline\n"
+		".hidden BkFiberTrampoline\n"
+		".type BkFiberTrampoline, @function\n"
+		"BkFiberTrampoline:\n"
+		"	callq *%r12\n"
+		"	ud2\n"
+		".size BkFiberTrampoline, .-BkFiberTrampoline\n");
+#elif defined(__aarch64__)
+	__asm__(
+		".text\n"
+		".globl BkSwitchFiberContext\n"
+		".hidden BkSwitchFiberContext\n"
+		".type BkSwitchFiberContext, %function\n"
+		"BkSwitchFiberContext:\n"
+		"	sub sp, sp, #160\n"
+		"	stp x19, x20, [sp, #0]\n"
+		"	stp x21, x22, [sp, #16]\n"
+		"	stp x23, x24, [sp, #32]\n"
+		"	stp x25, x26, [sp, #48]\n"
+		"	stp x27, x28, [sp, #64]\n"
+		"	stp x29, x30, [sp, #80]\n"
+		"	stp d8, d9, [sp, #96]\n"
+		"	stp d10, d11, [sp, #112]\n"
+		"	stp d12, d13, [sp, #128]\n"
+		"	stp d14, d15, [sp, #144]\n"
+		"	mov x2, sp\n"
+		"	str x2, [x0]\n"
+		"	mov sp, x1\n"
+		"	ldp x19, x20, [sp, #0]\n"
+		"	ldp x21, x22, [sp, #16]\n"
+		"	ldp x23, x24, [sp, #32]\n"
+		"	ldp x25, x26, [sp, #48]\n"
+		"	ldp x27, x28, [sp, #64]\n"
+		"	ldp x29, x30, [sp, #80]\n"
+		"	ldp d8, d9, [sp, #96]\n"
+		"	ldp d10, d11, [sp, #112]\n"
+		"	ldp d12, d13, [sp, #128]\n"
+		"	ldp d14, d15, [sp, #144]\n"
+		"	add sp, sp, #160\n"
+		"	ret\n"
+		".size BkSwitchFiberContext, .-BkSwitchFiberContext\n"
+		".globl BkFiberTrampoline\n"
+		".hidden BkFiberTrampoline\n"
+		".type BkFiberTrampoline, %function\n"
+		"BkFiberTrampoline:\n"
+		"	blr x19\n"
+		"	brk #0\n"
+		".size BkFiberTrampoline, .-BkFiberTrampoline\n");
+#endif
+
+	// A fiber can resume on another thread, so thread locals are looked up again after every switch through calls
+	// the compiler can't fold together
+	static __attribute__((noinline)) JobFiberThread& GetJobFiberThread()
+	{
+		__asm__ __volatile__("" ::: "memory");
+		return jobFiberThread;
+	}
+
+	static __attribute__((noinline)) uint32 GetCurrentJobWorker()
+	{
+		__asm__ __volatile__("" ::: "memory");
+		return jobWorkerIndex;
+	}
+#else
+	static uint32 GetCurrentJobWorker()
+	{
+		return jobWorkerIndex;
+	}
+#endif
+
+	// Rounds of failed searches before a worker goes to sleep
+	constexpr uint32 JobSpinCount = 64;
+
+#if !defined(BK_JOBS_SYNCHRONOUS)
+	static bool PushJob(JobQueue& queue, Job* job)
+	{
+		int64 bottom = __atomic_load_n(&queue.bottom, __ATOMIC_RELAXED);
+		int64 top = __atomic_load_n(&queue.top, __ATOMIC_ACQUIRE);
+
+		if (bottom - top > queue.mask)
+		{
+			return false;
+		}
+
+		// Release on the store itself rather than a fence, so the job's contents are published to thieves in a way
+		// race detectors can follow too
+		__atomic_store_n(&queue.jobs[bottom & queue.mask], job, __ATOMIC_RELAXED);
+		__atomic_store_n(&queue.bottom, bottom + 1, __ATOMIC_RELEASE);
+
+		return true;
+	}
+
+	static Job* PopJob(JobQueue& queue)
+	{
+		int64 bottom = __atomic_load_n(&queue.bottom, __ATOMIC_RELAXED) - 1;
+		__atomic_store_n(&queue.bottom, bottom, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		int64 top = __atomic_load_n(&queue.top, __ATOMIC_RELAXED);
+
+		if (top > bottom)
+		{
+			__atomic_store_n(&queue.bottom, bottom + 1, __ATOMIC_RELAXED);
+			return nullptr;
+		}
+
+		Job* job = __atomic_load_n(&queue.jobs[bottom & queue.mask], __ATOMIC_RELAXED);
+
+		if (top == bottom)
+		{
+			// Last job, race stealers for it
+			if (!__atomic_compare_exchange_n(&queue.top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+			{
+				job = nullptr;
+			}
+
+			__atomic_store_n(&queue.bottom, bottom + 1, __ATOMIC_RELAXED);
+		}
+
+		return job;
+	}
+
+	static Job* StealJob(JobQueue& queue)
+	{
+		int64 top = __atomic_load_n(&queue.top, __ATOMIC_ACQUIRE);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		int64 bottom = __atomic_load_n(&queue.bottom, __ATOMIC_ACQUIRE);
+
+		if (top >= bottom)
+		{
+			return nullptr;
+		}
+
+		Job* job = __atomic_load_n(&queue.jobs[top & queue.mask], __ATOMIC_RELAXED);
+		if (!__atomic_compare_exchange_n(&queue.top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		{
+			return nullptr;
+		}
+
+		return job;
+	}
+
+	static Job* FindJob(uint32 workerIdx)
+	{
+		JobQueue& queue = jobSystem.queues[workerIdx];
+
+		if (Job* job = PopJob(queue))
+		{
+			return job;
+		}
+
+		// Start at a random victim so thieves don't all pile onto the same queue
+		queue.random ^= queue.random << 13;
+		queue.random ^= queue.random >> 17;
+		queue.random ^= queue.random << 5;
+
+		uint32 workerCount = jobSystem.workerCount;
+		uint32 victimIdx = queue.random % workerCount;
+
+		for (uint32 attempt = 0; attempt < workerCount; ++attempt, victimIdx = (victimIdx + 1) % workerCount)
+		{
+			if (victimIdx == workerIdx)
+			{
+				continue;
+			}
+
+			if (Job* job = StealJob(jobSystem.queues[victimIdx]))
+			{
+				return job;
+			}
+		}
+
+		return nullptr;
+	}
+#endif
+
+#if defined(BK_JOBS_FIBERS)
+	static void WakeJobWorkers(size_t jobCount);
+#endif
+
+	static void ExecuteJob(Job* job)
+	{
+		JobCounter* counter = job->counter;
+		job->function(job->data);
+
+		// The job may be freed by its waiter as soon as the counter drops
+#if defined(BK_JOBS_FIBERS)
+		__atomic_sub_fetch(&counter->value, 1, __ATOMIC_SEQ_CST);
+
+		// One of the suspended fibers may be waiting on this counter, and every worker may be asleep
+		if (__atomic_load_n(&jobSystem.waitingFiberCount, __ATOMIC_SEQ_CST) > 0)
+		{
+			WakeJobWorkers(1);
+		}
+#else
+		__atomic_sub_fetch(&counter->value, 1, __ATOMIC_RELEASE);
+#endif
+	}
+
+	static void PauseJobWorker()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#elif defined(__aarch64__)
+		__asm__ __volatile__("yield");
+#endif
+	}
+
+#if !defined(BK_JOBS_SYNCHRONOUS)
+	static void WakeJobWorkers(size_t jobCount)
+	{
+		__atomic_add_fetch(&jobSystem.wakeEpoch, 1, __ATOMIC_SEQ_CST);
+
+		if (__atomic_load_n(&jobSystem.sleeperCount, __ATOMIC_SEQ_CST) == 0)
+		{
+			return;
+		}
+
+#if defined(BK_PLATFORM_WINDOWS)
+		AcquireSRWLockExclusive(&jobSystem.lock);
+		if (jobCount > 1)
+		{
+			WakeAllConditionVariable(&jobSystem.wake);
+		}
+		else
+		{
+			WakeConditionVariable(&jobSystem.wake);
+		}
+		ReleaseSRWLockExclusive(&jobSystem.lock);
+#else
+		pthread_mutex_lock(&jobSystem.lock);
+		if (jobCount > 1)
+		{
+			pthread_cond_broadcast(&jobSystem.wake);
+		}
+		else
+		{
+			pthread_cond_signal(&jobSystem.wake);
+		}
+		pthread_mutex_unlock(&jobSystem.lock);
+#endif
+	}
+
+#if defined(BK_JOBS_FIBERS)
+	static void LockJobFibers()
+	{
+		while (__atomic_exchange_n(&jobSystem.fiberLock, 1u, __ATOMIC_ACQUIRE))
+		{
+			PauseJobWorker();
+		}
+	}
+
+	static void UnlockJobFibers()
+	{
+		__atomic_store_n(&jobSystem.fiberLock, 0u, __ATOMIC_RELEASE);
+	}
+
+	static JobFiber* TakeFreeJobFiber()
+	{
+		LockJobFibers();
+
+		JobFiber* fiber = jobSystem.freeFibers;
+		if (fiber)
+		{
+			jobSystem.freeFibers = fiber->next;
+		}
+
+		UnlockJobFibers();
+
+		return fiber;
+	}
+
+	static bool IsJobFiberReady(const JobFiber* fiber)
+	{
+		return __atomic_load_n(&fiber->waitCounter->value, __ATOMIC_ACQUIRE) <= fiber->waitValue;
+	}
+
+	// Unlinks the first suspended fiber whose counter has dropped, or only checks for one when take is false
+	static JobFiber* FindReadyJobFiber(bool take)
+	{
+		if (__atomic_load_n(&jobSystem.waitingFiberCount, __ATOMIC_SEQ_CST) == 0)
+		{
+			return nullptr;
+		}
+
+		LockJobFibers();
+
+		JobFiber* fiber = nullptr;
+		for (JobFiber** link = &jobSystem.waitingFibers; *link; link = &(*link)->next)
+		{
+			if (IsJobFiberReady(*link))
+			{
+				fiber = *link;
+				if (take)
+				{
+					*link = fiber->next;
+					__atomic_sub_fetch(&jobSystem.waitingFiberCount, 1, __ATOMIC_SEQ_CST);
+				}
+				break;
+			}
+		}
+
+		UnlockJobFibers();
+
+		return fiber;
+	}
+#endif
+
+	static void SleepJobWorker(uint32 workerIdx)
+	{
+		__atomic_add_fetch(&jobSystem.sleeperCount, 1, __ATOMIC_SEQ_CST);
+		uint32 epoch = __atomic_load_n(&jobSystem.wakeEpoch, __ATOMIC_SEQ_CST);
+
+		// Anything pushed before the epoch was read is visible now, anything after moves the epoch
+		if (Job* job = FindJob(workerIdx))
+		{
+			__atomic_sub_fetch(&jobSystem.sleeperCount, 1, __ATOMIC_SEQ_CST);
+			ExecuteJob(job);
+			return;
+		}
+
+#if defined(BK_JOBS_FIBERS)
+		if (FindReadyJobFiber(false))
+		{
+			__atomic_sub_fetch(&jobSystem.sleeperCount, 1, __ATOMIC_SEQ_CST);
+			return;
+		}
+#endif
+
+#if defined(BK_PLATFORM_WINDOWS)
+		AcquireSRWLockExclusive(&jobSystem.lock);
+		while (!__atomic_load_n(&jobSystem.stopping, __ATOMIC_ACQUIRE) && __atomic_load_n(&jobSystem.wakeEpoch, __ATOMIC_SEQ_CST) == epoch)
+		{
+			SleepConditionVariableSRW(&jobSystem.wake, &jobSystem.lock, INFINITE, 0);
+		}
+		ReleaseSRWLockExclusive(&jobSystem.lock);
+#else
+		pthread_mutex_lock(&jobSystem.lock);
+		while (!__atomic_load_n(&jobSystem.stopping, __ATOMIC_ACQUIRE) && __atomic_load_n(&jobSystem.wakeEpoch, __ATOMIC_SEQ_CST) == epoch)
+		{
+			pthread_cond_wait(&jobSystem.wake, &jobSystem.lock);
+		}
+		pthread_mutex_unlock(&jobSystem.lock);
+#endif
+
+		__atomic_sub_fetch(&jobSystem.sleeperCount, 1, __ATOMIC_SEQ_CST);
+	}
+
+#if defined(BK_JOBS_FIBERS)
+	// Completes the action requested for the fiber that was switched away from, now that its stack is free
+	static void FinishJobFiberSwitch()
+	{
+		JobFiberThread& thread = GetJobFiberThread();
+		JobFiber* previous = thread.previousFiber;
+		JobFiberAction action = thread.previousAction;
+
+		thread.previousFiber = nullptr;
+		thread.previousAction = JobFiberAction::None;
+
+		if (!previous || action == JobFiberAction::None)
+		{
+			return;
+		}
+
+		LockJobFibers();
+
+		if (action == JobFiberAction::Free)
+		{
+			previous->next = jobSystem.freeFibers;
+			jobSystem.freeFibers = previous;
+		}
+		else
+		{
+			previous->next = jobSystem.waitingFibers;
+			jobSystem.waitingFibers = previous;
+			__atomic_add_fetch(&jobSystem.waitingFiberCount, 1, __ATOMIC_SEQ_CST);
+		}
+
+		UnlockJobFibers();
+	}
+
+	// Null switches back to the thread's own stack
+	static void SwitchJobFiber(JobFiber* target, JobFiberAction action)
+	{
+		JobFiberThread& thread = GetJobFiberThread();
+		JobFiber* current = thread.currentFiber;
+
+		thread.previousFiber = current;
+		thread.previousAction = action;
+		thread.currentFiber = target;
+
+		void** saveContext = current ? &current->context : &thread.threadContext;
+		BkSwitchFiberContext(saveContext, target ? target->context : thread.threadContext);
+
+		// Possibly on another thread from here on
+		FinishJobFiberSwitch();
+	}
+
+	// Fibers never return. One that is freed halfway through this loop picks up where it left off when it's reused
+	static void RunJobFiber()
+	{
+		FinishJobFiberSwitch();
+
+		uint32 idleCount = 0;
+
+		for (;;)
+		{
+			if (__atomic_load_n(&jobSystem.stopping, __ATOMIC_ACQUIRE))
+			{
+				SwitchJobFiber(nullptr, JobFiberAction::Free);
+				continue;
+			}
+
+			uint32 workerIdx = GetCurrentJobWorker();
+
+			if (JobFiber* fiber = FindReadyJobFiber(true))
+			{
+				SwitchJobFiber(fiber, JobFiberAction::Free);
+				idleCount = 0;
+			}
+			else if (Job* job = FindJob(workerIdx))
+			{
+				ExecuteJob(job);
+				idleCount = 0;
+			}
+			else if (++idleCount < JobSpinCount)
+			{
+				PauseJobWorker();
+			}
+			else
+			{
+				SleepJobWorker(workerIdx);
+				idleCount = 0;
+			}
+		}
+	}
+
+	static void* PrepareJobFiberContext(uint8* stackEnd)
+	{
+		uintptr_t stackTop = reinterpret_cast<uintptr_t>(stackEnd) & ~uintptr_t(15);
+		uintptr_t function = reinterpret_cast<uintptr_t>(&RunJobFiber);
+		uintptr_t trampoline = reinterpret_cast<uintptr_t>(&BkFiberTrampoline);
+
+#if defined(__x86_64__)
+		// r15, r14, r13, r12, rbx, rbp and the return address, placed so the trampoline starts 16 byte aligned
+		uintptr_t* frame = reinterpret_cast<uintptr_t*>(stackTop - 9 * sizeof(uintptr_t));
+		MemoryZero(frame, 9 * sizeof(uintptr_t));
+		frame[3] = function;
+		frame[6] = trampoline;
+#else
+		// x19 to x30 followed by d8 to d15, the trampoline is reached through x30
+		uintptr_t* frame = reinterpret_cast<uintptr_t*>(stackTop - 20 * sizeof(uintptr_t));
+		MemoryZero(frame, 20 * sizeof(uintptr_t));
+		frame[0] = function;
+		frame[11] = trampoline;
+#endif
+
+		return frame;
+	}
+
+	static bool CreateJobFibers(Arena* arena, uint32 fiberCount, size_t fiberStackSize)
+	{
+		size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		size_t stackSize = AlignUp(fiberStackSize, pageSize) + pageSize;
+
+		jobSystem.fibers = arena->PushZeroed<JobFiber>(fiberCount);
+
+		for (uint32 fiberIdx = 0; fiberIdx < fiberCount; ++fiberIdx)
+		{
+			// Lowest page is left inaccessible so an overflow faults instead of running into another stack
+			void* stack = mmap(nullptr, stackSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+			if (stack == MAP_FAILED || mprotect(stack, pageSize, PROT_NONE) != 0)
+			{
+				if (stack != MAP_FAILED)
+				{
+					munmap(stack, stackSize);
+				}
+				return false;
+			}
+
+			JobFiber& fiber = jobSystem.fibers[fiberIdx];
+			fiber.stack = static_cast<uint8*>(stack);
+			fiber.stackSize = stackSize;
+			fiber.context = PrepareJobFiberContext(fiber.stack + stackSize);
+			fiber.scratchArena.tag = MemoryTag::Jobs;
+			fiber.next = jobSystem.freeFibers;
+
+			jobSystem.freeFibers = &fiber;
+			jobSystem.fiberCount += 1;
+		}
+
+		return true;
+	}
+
+	static void DestroyJobFibers()
+	{
+		for (uint32 fiberIdx = 0; fiberIdx < jobSystem.fiberCount; ++fiberIdx)
+		{
+			munmap(jobSystem.fibers[fiberIdx].stack, jobSystem.fibers[fiberIdx].stackSize);
+			jobSystem.fibers[fiberIdx].scratchArena.SetMarker({});
+		}
+	}
+#endif
+
+	static void RunJobWorker(uint32 workerIdx)
+	{
+		jobWorkerIndex = workerIdx;
+
+#if defined(BK_JOBS_FIBERS)
+		// The thread's own stack only starts the first fiber, and is switched back to once the workers stop
+		if (JobFiber* fiber = TakeFreeJobFiber())
+		{
+			SwitchJobFiber(fiber, JobFiberAction::None);
+			return;
+		}
+#endif
+
+		uint32 idleCount = 0;
+
+		while (!__atomic_load_n(&jobSystem.stopping, __ATOMIC_ACQUIRE))
+		{
+			if (Job* job = FindJob(workerIdx))
+			{
+				ExecuteJob(job);
+				idleCount = 0;
+			}
+			else if (++idleCount < JobSpinCount)
+			{
+				PauseJobWorker();
+			}
+			else
+			{
+				SleepJobWorker(workerIdx);
+				idleCount = 0;
+			}
+		}
+	}
+
+#if defined(BK_PLATFORM_WINDOWS)
+	static DWORD WINAPI JobWorker(void* userData)
+	{
+		RunJobWorker(static_cast<uint32>(reinterpret_cast<uintptr_t>(userData)));
+		return 0;
+	}
+#else
+	static void* JobWorker(void* userData)
+	{
+		RunJobWorker(static_cast<uint32>(reinterpret_cast<uintptr_t>(userData)));
+		return nullptr;
+	}
+#endif
+
+	static uint32 GetCoreCount()
+	{
+#if defined(BK_PLATFORM_WINDOWS)
+		SYSTEM_INFO systemInfo = {};
+		GetSystemInfo(&systemInfo);
+
+		return systemInfo.dwNumberOfProcessors;
+#elif defined(BK_PLATFORM_EMSCRIPTEN)
+		return static_cast<uint32>(emscripten_num_logical_cores());
+#else
+		long coreCount = sysconf(_SC_NPROCESSORS_ONLN);
+		return coreCount > 0 ? static_cast<uint32>(coreCount) : 1;
+#endif
+	}
+#endif
+
+	bool JobsInitialize(Arena* arena, uint32 workerCount, uint32 queueCapacity, uint32 fiberCount, size_t fiberStackSize)
+	{
+		BK_ASSERT(queueCapacity > 0 && (queueCapacity & (queueCapacity - 1)) == 0);
+
+		jobSystem = {};
+
+#if defined(BK_JOBS_SYNCHRONOUS)
+		workerCount = 1;
+#else
+		workerCount = workerCount > 0 ? workerCount : BK_MAX(GetCoreCount(), 1u);
+#endif
+
+		jobSystem.workerCount = workerCount;
+		jobSystem.queues = arena->PushZeroed<JobQueue>(workerCount);
+
+		for (uint32 workerIdx = 0; workerIdx < workerCount; ++workerIdx)
+		{
+			JobQueue& queue = jobSystem.queues[workerIdx];
+			queue.jobs = arena->PushZeroed<Job*>(queueCapacity);
+			queue.mask = queueCapacity - 1;
+			queue.random = 0x9E3779B9u * (workerIdx + 1);
+			queue.scratchArena.tag = MemoryTag::Jobs;
+		}
+
+#if defined(BK_JOBS_FIBERS)
+		// Worker 0 is the calling thread, which keeps its own stack, so fibers are only of use with other workers
+		if (fiberCount > 0 && workerCount > 1 && !CreateJobFibers(arena, fiberCount, fiberStackSize))
+		{
+			DestroyJobFibers();
+			jobSystem = {};
+			return false;
+		}
+#endif
+
+		jobWorkerIndex = 0;
+
+#if !defined(BK_JOBS_SYNCHRONOUS)
+#if defined(BK_PLATFORM_WINDOWS)
+		InitializeSRWLock(&jobSystem.lock);
+		InitializeConditionVariable(&jobSystem.wake);
+
+		jobSystem.workers = arena->PushZeroed<HANDLE>(workerCount);
+		for (uint32 workerIdx = 1; workerIdx < workerCount; ++workerIdx)
+		{
+			void* userData = reinterpret_cast<void*>(uintptr_t(workerIdx));
+			jobSystem.workers[workerIdx] = CreateThread(nullptr, 0, JobWorker, userData, 0, nullptr);
+			if (!jobSystem.workers[workerIdx])
+			{
+				JobsShutdown();
+				return false;
+			}
+		}
+#else
+		pthread_mutex_init(&jobSystem.lock, nullptr);
+		pthread_cond_init(&jobSystem.wake, nullptr);
+
+		jobSystem.workers = arena->PushZeroed<pthread_t>(workerCount);
+		for (uint32 workerIdx = 1; workerIdx < workerCount; ++workerIdx)
+		{
+			void* userData = reinterpret_cast<void*>(uintptr_t(workerIdx));
+			if (pthread_create(&jobSystem.workers[workerIdx], nullptr, JobWorker, userData) != 0)
+			{
+				JobsShutdown();
+				return false;
+			}
+		}
+#endif
+#endif
+
+		return true;
+	}
+
+	void JobsShutdown()
+	{
+		if (!jobSystem.queues)
+		{
+			return;
+		}
+
+#if !defined(BK_JOBS_SYNCHRONOUS)
+		__atomic_store_n(&jobSystem.stopping, true, __ATOMIC_RELEASE);
+
+#if defined(BK_PLATFORM_WINDOWS)
+		AcquireSRWLockExclusive(&jobSystem.lock);
+		WakeAllConditionVariable(&jobSystem.wake);
+		ReleaseSRWLockExclusive(&jobSystem.lock);
+
+		for (uint32 workerIdx = 1; workerIdx < jobSystem.workerCount; ++workerIdx)
+		{
+			if (jobSystem.workers[workerIdx])
+			{
+				WaitForSingleObject(jobSystem.workers[workerIdx], INFINITE);
+				CloseHandle(jobSystem.workers[workerIdx]);
+			}
+		}
+#else
+		pthread_mutex_lock(&jobSystem.lock);
+		pthread_cond_broadcast(&jobSystem.wake);
+		pthread_mutex_unlock(&jobSystem.lock);
+
+		for (uint32 workerIdx = 1; workerIdx < jobSystem.workerCount; ++workerIdx)
+		{
+			if (jobSystem.workers[workerIdx])
+			{
+				pthread_join(jobSystem.workers[workerIdx], nullptr);
+			}
+		}
+
+		pthread_cond_destroy(&jobSystem.wake);
+		pthread_mutex_destroy(&jobSystem.lock);
+#endif
+#endif
+
+#if defined(BK_JOBS_FIBERS)
+		DestroyJobFibers();
+#endif
+
+		for (uint32 workerIdx = 0; workerIdx < jobSystem.workerCount; ++workerIdx)
+		{
+			jobSystem.queues[workerIdx].scratchArena.SetMarker({});
+		}
+
+		jobSystem = {};
+		jobWorkerIndex = UINT32_MAX;
+	}
+
+	void RunJobs(TSpan<Job> jobs, JobCounter* counter)
+	{
+		__atomic_add_fetch(&counter->value, static_cast<uint32>(jobs.length), __ATOMIC_RELAXED);
+
+#if defined(BK_JOBS_SYNCHRONOUS)
+		for (size_t jobIdx = 0; jobIdx < jobs.length; ++jobIdx)
+		{
+			jobs.data[jobIdx].counter = counter;
+			ExecuteJob(&jobs.data[jobIdx]);
+		}
+#else
+		for (size_t jobIdx = 0; jobIdx < jobs.length; ++jobIdx)
+		{
+			Job* job = &jobs.data[jobIdx];
+			job->counter = counter;
+
+			// A job run inline can wait and resume on another worker, so the index is looked up for every job
+			uint32 workerIdx = GetCurrentJobWorker();
+			if (workerIdx == UINT32_MAX || !PushJob(jobSystem.queues[workerIdx], job))
+			{
+				ExecuteJob(job);
+			}
+		}
+
+		if (GetCurrentJobWorker() != UINT32_MAX)
+		{
+			WakeJobWorkers(jobs.length);
+		}
+#endif
+	}
+
+	void RunJob(Job& job, JobCounter* counter)
+	{
+		RunJobs(TSpan(&job, 1), counter);
+	}
+
+	void WaitForCounter(JobCounter* counter, uint32 value)
+	{
+#if defined(BK_JOBS_FIBERS)
+		JobFiber* current = GetJobFiberThread().currentFiber;
+
+		if (current && __atomic_load_n(&counter->value, __ATOMIC_ACQUIRE) > value)
+		{
+			if (JobFiber* next = TakeFreeJobFiber())
+			{
+				current->waitCounter = counter;
+				current->waitValue = value;
+
+				// Parked on the waiting list once switched away from, and resumed by whichever worker sees the counter drop
+				SwitchJobFiber(next, JobFiberAction::Wait);
+				return;
+			}
+		}
+#endif
+
+		while (__atomic_load_n(&counter->value, __ATOMIC_ACQUIRE) > value)
+		{
+#if !defined(BK_JOBS_SYNCHRONOUS)
+			// Jobs run here can wait too and come back on another worker, whose queue is the one to use from then on
+			uint32 workerIdx = GetCurrentJobWorker();
+			Job* job = workerIdx != UINT32_MAX ? FindJob(workerIdx) : nullptr;
+			if (job)
+			{
+				ExecuteJob(job);
+				continue;
+			}
+#endif
+
+			PauseJobWorker();
+		}
+	}
+
+	uint32 GetJobWorkerCount()
+	{
+		return jobSystem.workerCount;
+	}
+
+	uint32 GetJobWorkerIndex()
+	{
+		return GetCurrentJobWorker();
+	}
+
+	Arena& GetJobScratchArena()
+	{
+#if defined(BK_JOBS_FIBERS)
+		// A suspended fiber's scratch stays untouched while other jobs run on its worker
+		if (JobFiber* fiber = GetJobFiberThread().currentFiber)
+		{
+			return fiber->scratchArena;
+		}
+#endif
+
+		uint32 workerIdx = GetCurrentJobWorker();
+		return workerIdx != UINT32_MAX ? jobSystem.queues[workerIdx].scratchArena : jobScratchArena;
+	}
+
+	size_t GetFileInfosParallel(TSpan<const char*> paths, TSpan<FileInfo> infos)
+	{
+		BK_ASSERT(infos.length >= paths.length);
+
+		auto getInfos = [paths, infos](TSpan<const char*> range, Arena&)
+		{
+			size_t first = static_cast<size_t>(range.data - paths.data);
+			return GetFileInfos(range, TSpan(infos.data + first, range.length));
+		};
+
+		auto sum = [](size_t left, size_t right) { return left + right; };
+
+		return ParallelReduce(paths, 64, size_t(0), getInfos, sum);
+	}
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include "BkArena.h"
+#include "BkCore.h"
+#include "BkMemory.h"
+#include "BkSpan.h"
+
+namespace Bk
+{
+	struct FileInfo;
+	struct JobCounter;
+
+	using JobFunction = void (*)(void* data);
+
+	struct Job
+	{
+		JobFunction function;
+		void* data;
+		JobCounter* counter; // Set when the job is submitted
+	};
+
+	// Pending job count, raised when jobs are submitted and lowered as each one finishes
+	struct JobCounter
+	{
+		uint32 value;
+	};
+
+	// The calling thread becomes worker 0, so workerCount includes it. 0 starts one worker per core. Where fibers are
+	// supported, jobs on the other workers run on a pool of fiberCount fibers, 0 disables them
+	bool JobsInitialize(Arena* arena, uint32 workerCount = 0, uint32 queueCapacity = 4096, uint32 fiberCount = 128,
+		size_t fiberStackSize = BK_KILOBYTES(256));
+	void JobsShutdown();
+
+	// Jobs are queued by pointer and must stay alive until their counter drops. Jobs submitted from threads that
+	// aren't workers, or that don't fit in the queue, run inline
+	void RunJobs(TSpan<Job> jobs, JobCounter* counter);
+	void RunJob(Job& job, JobCounter* counter);
+
+	// Jobs running on a fiber are suspended until the counter drops to value, and the worker moves on to other jobs.
+	// Anywhere else, or when every fiber is in use, queued jobs are run until then instead
+	void WaitForCounter(JobCounter* counter, uint32 value = 0);
+
+	uint32 GetJobWorkerCount();
+	uint32 GetJobWorkerIndex(); // UINT32_MAX on threads that aren't workers
+
+	// Per fiber where jobs run on fibers, otherwise per worker, or per thread on threads that aren't workers. Jobs run
+	// inline while another one waits share it in stack order, so anything pushed must be popped before the job returns
+	Arena& GetJobScratchArena();
+
+	// Calls function(TSpan<T> range, Arena& scratch) on consecutive ranges of at least grainSize items, spread
+	// over the workers. Scratch is the job's scratch arena, reset after each call
+	template<typename T, typename Function>
+	void ParallelFor(TSpan<T> items, size_t grainSize, const Function& function);
+
+	// Maps ranges like ParallelFor with map(TSpan<T> range, Arena& scratch) -> Result, then folds the results of
+	// neighbouring ranges in order with combine(Result left, Result right). Identity is only returned for no items
+	template<typename T, typename Result, typename Map, typename Combine>
+	Result ParallelReduce(TSpan<T> items, size_t grainSize, Result identity, const Map& map, const Combine& combine);
+
+	// GetFileInfos with the lookups spread over the workers, each one is a syscall so this pays off for many paths
+	size_t GetFileInfosParallel(TSpan<const char*> paths, TSpan<FileInfo> infos);
+}
+
+namespace Bk
+{
+	// Ranges are halved down to the grain size while the task has splits left. The budget covers a few ranges per
+	// worker, and is topped up whenever a range is stolen, so splitting continues only where workers are idle
+	constexpr uint32 ParallelMaxSplits = 16;
+
+	inline uint32 GetParallelSplitBudget()
+	{
+		uint32 workerCount = GetJobWorkerCount();
+		if (workerCount <= 1)
+		{
+			return 0;
+		}
+
+		uint32 budget = 2;
+		for (; workerCount > 1; workerCount = (workerCount + 1) / 2)
+		{
+			budget += 1;
+		}
+
+		return BK_MIN(budget, ParallelMaxSplits);
+	}
+
+	template<typename Body>
+	struct TParallelTask
+	{
+		static void Run(void* data);
+
+		const Body* body;
+		size_t begin;
+		size_t end;
+		uint32 splitBudget;
+		uint32 ownerIdx;
+		typename Body::Result result;
+	};
+
+	template<typename Body>
+	void TParallelTask<Body>::Run(void* data)
+	{
+		TParallelTask& task = *static_cast<TParallelTask*>(data);
+
+		uint32 workerIdx = GetJobWorkerIndex();
+		uint32 splitBudget = workerIdx == task.ownerIdx ? task.splitBudget : BK_MAX(task.splitBudget, GetParallelSplitBudget());
+
+		TParallelTask children[ParallelMaxSplits];
+		Job jobs[ParallelMaxSplits];
+		JobCounter counter = {};
+
+		size_t begin = task.begin;
+		size_t end = task.end;
+		uint32 childCount = 0;
+
+		// Right halves go to the queue, the left half is kept and split further
+		while (splitBudget > 0 && end - begin > task.body->grainSize && workerIdx != UINT32_MAX)
+		{
+			size_t middle = begin + (end - begin) / 2;
+			splitBudget -= 1;
+
+			TParallelTask& child = children[childCount];
+			child.body = task.body;
+			child.begin = middle;
+			child.end = end;
+			child.splitBudget = splitBudget;
+			child.ownerIdx = workerIdx;
+
+			jobs[childCount] = {Run, &child, nullptr};
+			RunJob(jobs[childCount], &counter);
+
+			childCount += 1;
+			end = middle;
+		}
+
+		Arena& scratch = GetJobScratchArena();
+		ArenaMarker marker = scratch.GetMarker();
+
+		task.result = task.body->Map(begin, end, scratch);
+		scratch.SetMarker(marker);
+
+		WaitForCounter(&counter);
+
+		// The most recent split is the nearest right neighbour
+		for (uint32 childIdx = childCount; childIdx > 0; --childIdx)
+		{
+			task.result = task.body->Combine(task.result, children[childIdx - 1].result);
+		}
+	}
+
+	template<typename Body>
+	typename Body::Result RunParallelTask(const Body& body, size_t count)
+	{
+		TParallelTask<Body> task = {};
+		task.body = &body;
+		task.begin = 0;
+		task.end = count;
+		task.splitBudget = GetParallelSplitBudget();
+		task.ownerIdx = GetJobWorkerIndex();
+
+		TParallelTask<Body>::Run(&task);
+
+		return task.result;
+	}
+
+	template<typename T, typename Function>
+	struct TParallelForBody
+	{
+		struct Result
+		{
+		};
+
+		Result Map(size_t begin, size_t end, Arena& scratch) const
+		{
+			(*function)(TSpan<T>(items.data + begin, end - begin), scratch);
+			return {};
+		}
+
+		Result Combine(Result left, Result right) const
+		{
+			return {};
+		}
+
+		TSpan<T> items;
+		size_t grainSize;
+		const Function* function;
+	};
+
+	template<typename T, typename ResultType, typename MapFunction, typename CombineFunction>
+	struct TParallelReduceBody
+	{
+		using Result = ResultType;
+
+		Result Map(size_t begin, size_t end, Arena& scratch) const
+		{
+			return (*map)(TSpan<T>(items.data + begin, end - begin), scratch);
+		}
+
+		Result Combine(Result left, Result right) const
+		{
+			return (*combine)(left, right);
+		}
+
+		TSpan<T> items;
+		size_t grainSize;
+		const MapFunction* map;
+		const CombineFunction* combine;
+	};
+
+	template<typename T, typename Function>
+	void ParallelFor(TSpan<T> items, size_t grainSize, const Function& function)
+	{
+		if (items.length > 0)
+		{
+			TParallelForBody<T, Function> body = {items, BK_MAX(grainSize, size_t(1)), &function};
+			RunParallelTask(body, items.length);
+		}
+	}
+
+	template<typename T, typename Result, typename Map, typename Combine>
+	Result ParallelReduce(TSpan<T> items, size_t grainSize, Result identity, const Map& map, const Combine& combine)
+	{
+		if (items.length == 0)
+		{
+			return identity;
+		}
+
+		TParallelReduceBody<T, Result, Map, Combine> body = {items, BK_MAX(grainSize, size_t(1)), &map, &combine};
+		return RunParallelTask(body, items.length);
+	}
+}
@@ -4,34 +4,144 @@
 
 namespace Bk
 {
-	JsonValue* ParseJson(Arena& arena, String json)
+	enum class JsonExpect : uint8
+	{
+		Value,
+		ValueOrEnd,
+		Key,
+		KeyOrEnd,
+		Colon,
+		CommaOrEnd,
+		Done,
+	};
+
+	JsonValue* ParseJson(Arena& arena, String json, JsonParseResult* result)
 	{
 		ArenaMarker marker = arena.GetMarker();
 
 		JsonValue* root = nullptr;
 		JsonValue* scope = nullptr;
+		uint32 depth = 0;
+
+		JsonExpect expect = JsonExpect::Value;
+		JsonError error = JsonError::None;
 
-		for (size_t position = 0; position < json.length; position += 1)
+		size_t position = 0;
+		for (; position < json.length; position += 1)
 		{
 			JsonValue* current = nullptr;
+			bool isKey = false;
 			char c = json.data[position];
 
+			if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+			{
+				continue;
+			}
+
+			if (c == ',')
+			{
+				if (expect != JsonExpect::CommaOrEnd)
+				{
+					error = expect == JsonExpect::Colon ? JsonError::MissingColon : JsonError::UnexpectedCharacter;
+					break;
+				}
+
+				expect = scope->type == JsonType::Object ? JsonExpect::Key : JsonExpect::Value;
+				continue;
+			}
+
+			if (c == ':')
+			{
+				if (expect != JsonExpect::Colon)
+				{
+					error = JsonError::UnexpectedCharacter;
+					break;
+				}
+
+				expect = JsonExpect::Value;
+				continue;
+			}
+
+			if (c == '}' || c == ']')
+			{
+				JsonType scopeType = c == '}' ? JsonType::Object : JsonType::Array;
+
+				if (!scope || scope->type != scopeType)
+				{
+					if (scope)
+					{
+						error = JsonError::MismatchedBracket;
+					}
+					else
+					{
+						error = expect == JsonExpect::Done ? JsonError::TrailingCharacters : JsonError::UnexpectedCharacter;
+					}
+					break;
+				}
+
+				if (expect == JsonExpect::Key || (expect == JsonExpect::Value && scopeType == JsonType::Array))
+				{
+					error = JsonError::TrailingComma;
+					break;
+				}
+
+				if (expect != JsonExpect::CommaOrEnd && expect != JsonExpect::KeyOrEnd && expect != JsonExpect::ValueOrEnd)
+				{
+					error = expect == JsonExpect::Colon ? JsonError::MissingColon : JsonError::UnexpectedCharacter;
+					break;
+				}
+
+			}
+			else
+			{
+				// Anything else starts a value, check that one is allowed here before parsing it
+				if (expect == JsonExpect::Colon)
+				{
+					error = JsonError::MissingColon;
+					break;
+				}
+
+				if (expect == JsonExpect::CommaOrEnd)
+				{
+					error = JsonError::MissingComma;
+					break;
+				}
+
+				if (expect == JsonExpect::Done)
+				{
+					error = JsonError::TrailingCharacters;
+					break;
+				}
+
+				isKey = expect == JsonExpect::Key || expect == JsonExpect::KeyOrEnd;
+				if (isKey && c != '"')
+				{
+					error = JsonError::UnexpectedCharacter;
+					break;
+				}
+			}
+
 			if (c == '{' || c == '[')
 			{
+				if (depth == JsonMaxDepth)
+				{
+					error = JsonError::TooDeep;
+					break;
+				}
+
+				depth += 1;
+
 				JsonValue* newScope = arena.PushZeroed<JsonValue>();
 				newScope->type = c == '{' ? JsonType::Object : JsonType::Array;
 				newScope->value.data = json.data + position;
 				newScope->parent = scope;
 
 				scope = newScope;
+				expect = c == '{' ? JsonExpect::KeyOrEnd : JsonExpect::ValueOrEnd;
 			}
 			else if (c == '}' || c == ']')
 			{
-				if (!scope)
-				{
-					// Invalid object/array
-					break;
-				}
+				depth -= 1;
 
 				current = scope;
 				current->value.length = size_t(json.data + position + 1 - current->value.data);
@@ -51,17 +161,24 @@ namespace Bk
 						current = arena.PushZeroed<JsonValue>();
 						current->type = JsonType::String;
 						current->value = json.Range(start, position);
+						current->hash = isKey ? StringHash(current->value) : 0;
 						current->parent = scope;
 
 						break;
 					}
 
-					if (c == '\\' && position + 1 < json.length)
+					if (static_cast<uint8>(c) < 0x20)
+					{
+						error = JsonError::ControlCharacter;
+						break;
+					}
+
+					if (c == '\\')
 					{
 						static constexpr AsciiSet escapeChars("\"\\/bfnrt");
 
 						position += 1;
-						c = json.data[position];
+						c = position < json.length ? json.data[position] : '\0';
 
 						if (c == 'u' && position + 4 < json.length)
 						{
@@ -73,6 +190,7 @@ namespace Bk
 							if (!IsHexDigit(c1) || !IsHexDigit(c2) || !IsHexDigit(c3) || !IsHexDigit(c4))
 							{
 								// Invalid codepoint
+								error = JsonError::InvalidEscape;
 								break;
 							}
 
@@ -80,7 +198,7 @@ namespace Bk
 						}
 						else if (!escapeChars.Contains(c))
 						{
-							// Invalid escape sequence
+							error = position < json.length ? JsonError::InvalidEscape : JsonError::UnexpectedEnd;
 							break;
 						}
 					}
@@ -88,7 +206,12 @@ namespace Bk
 
 				if (!current)
 				{
-					// Invalid string
+					if (error == JsonError::None)
+					{
+						// Unterminated string
+						error = JsonError::UnexpectedEnd;
+					}
+
 					break;
 				}
 			}
@@ -96,32 +219,78 @@ namespace Bk
 			{
 				size_t start = position;
 
-				static constexpr AsciiSet numberChars("0123456789.+-eE");
-				for (; position < json.length; position += 1)
+				// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+				if (c == '-')
 				{
-					c = json.data[position];
+					position += 1;
+				}
 
-					if (!numberChars.Contains(c))
+				if (position < json.length && json.data[position] == '0')
+				{
+					position += 1;
+
+					if (position < json.length && IsDigit(json.data[position]))
 					{
-						current = arena.PushZeroed<JsonValue>();
-						current->type = JsonType::Number;
-						current->value = json.Range(start, position);
-						current->parent = scope;
-						current->value.Parse(current->asNumber);
+						// Leading zero
+						error = JsonError::InvalidNumber;
+						break;
+					}
+				}
+				else if (position < json.length && IsDigit(json.data[position]))
+				{
+					for (; position < json.length && IsDigit(json.data[position]); position += 1) {}
+				}
+				else
+				{
+					error = JsonError::InvalidNumber;
+					break;
+				}
 
-						position -= 1;
+				if (position < json.length && json.data[position] == '.')
+				{
+					position += 1;
+
+					if (position >= json.length || !IsDigit(json.data[position]))
+					{
+						error = JsonError::InvalidNumber;
 						break;
 					}
+
+					for (; position < json.length && IsDigit(json.data[position]); position += 1) {}
 				}
 
-				if (position == json.length)
+				if (position < json.length && (json.data[position] == 'e' || json.data[position] == 'E'))
 				{
-					current = arena.PushZeroed<JsonValue>();
-					current->type = JsonType::Number;
-					current->value = json.Range(start, position);
-					current->parent = scope;
-					current->value.Parse(current->asNumber);
+					position += 1;
+
+					if (position < json.length && (json.data[position] == '+' || json.data[position] == '-'))
+					{
+						position += 1;
+					}
+
+					if (position >= json.length || !IsDigit(json.data[position]))
+					{
+						error = JsonError::InvalidNumber;
+						break;
+					}
+
+					for (; position < json.length && IsDigit(json.data[position]); position += 1) {}
 				}
+
+				current = arena.PushZeroed<JsonValue>();
+				current->type = JsonType::Number;
+				current->value = json.Range(start, position);
+				current->parent = scope;
+
+				if (!current->value.Parse(current->asNumber))
+				{
+					// Out of range
+					position = start;
+					error = JsonError::InvalidNumber;
+					break;
+				}
+
+				position -= 1;
 			}
 			else if (c == 't')
 			{
@@ -180,22 +349,86 @@ namespace Bk
 
 					scope->sibling = current;
 					scope->children += 1;
+
+					expect = isKey ? JsonExpect::Colon : JsonExpect::CommaOrEnd;
 				}
-				else if (!root)
+				else
 				{
 					root = current;
+					expect = JsonExpect::Done;
 				}
 			}
+			else if (c != '{' && c != '[')
+			{
+				error = (c == 't' || c == 'f' || c == 'n') ? JsonError::InvalidLiteral : JsonError::UnexpectedCharacter;
+				break;
+			}
 		}
 
-		if (!root)
+		if (error == JsonError::None && expect != JsonExpect::Done)
 		{
+			// Truncated document
+			error = JsonError::UnexpectedEnd;
+		}
+
+		if (error != JsonError::None)
+		{
+			root = nullptr;
 			arena.SetMarker(marker);
 		}
 
+		if (result)
+		{
+			*result = {};
+			result->error = error;
+
+			if (error != JsonError::None)
+			{
+				// Only resolve the location once parsing has failed, keeping it off the valid path
+				result->offset = BK_MIN(position, json.length);
+				result->line = 1;
+				result->column = 1;
+
+				for (size_t idx = 0; idx < result->offset; ++idx)
+				{
+					if (json.data[idx] == '\n')
+					{
+						result->line += 1;
+						result->column = 1;
+					}
+					else
+					{
+						result->column += 1;
+					}
+				}
+			}
+		}
+
 		return root;
 	}
 
+	const char* GetJsonErrorString(JsonError error)
+	{
+		switch (error)
+		{
+			case JsonError::None: return "None";
+			case JsonError::UnexpectedEnd: return "Unexpected end of input";
+			case JsonError::UnexpectedCharacter: return "Unexpected character";
+			case JsonError::TrailingCharacters: return "Trailing characters after root value";
+			case JsonError::TrailingComma: return "Trailing comma";
+			case JsonError::MissingComma: return "Missing comma";
+			case JsonError::MissingColon: return "Missing colon";
+			case JsonError::MismatchedBracket: return "Mismatched bracket";
+			case JsonError::InvalidLiteral: return "Invalid literal";
+			case JsonError::InvalidNumber: return "Invalid number";
+			case JsonError::InvalidEscape: return "Invalid escape sequence";
+			case JsonError::ControlCharacter: return "Unescaped control character in string";
+			case JsonError::TooDeep: return "Arrays and objects nested too deeply";
+		}
+
+		return "Unknown";
+	}
+
 	JsonValue* FindJsonValue(JsonValue* value, String path)
 	{
 		while (value && path.length > 0)
@@ -265,4 +498,333 @@ namespace Bk
 
 		return child;
 	}
+
+	bool CompileJsonQuery(Arena& arena, String path, JsonQuery& query)
+	{
+		query.steps = {};
+
+		const bool isPointer = path.length > 0 && path.data[0] == '/';
+		const char delimiter = isPointer ? '/' : '.';
+
+		if (isPointer)
+		{
+			path = path.Slice(1);
+		}
+		else if (path.length == 0)
+		{
+			// Empty path refers to the value itself
+			return true;
+		}
+
+		size_t stepCount = 1;
+		for (char c : path)
+		{
+			stepCount += c == delimiter;
+		}
+
+		ArenaMarker marker = arena.GetMarker();
+		JsonQueryStep* steps = arena.PushZeroed<JsonQueryStep>(stepCount);
+
+		for (size_t stepIdx = 0; stepIdx < stepCount; ++stepIdx)
+		{
+			size_t delimiterIdx = path.Find(delimiter);
+			String segment = path.Range(0, delimiterIdx);
+
+			JsonQueryStep& step = steps[stepIdx];
+			step.index = SIZE_MAX;
+
+			if (segment == "*")
+			{
+				step.type = JsonQueryStepType::Wildcard;
+			}
+			else if (segment == "**")
+			{
+				step.type = JsonQueryStepType::Descendant;
+			}
+			else
+			{
+				step.type = JsonQueryStepType::Key;
+				step.key = segment;
+
+				if (isPointer && segment.Contains('~'))
+				{
+					// Unescape '~1' to '/' and '~0' to '~'
+					char* key = reinterpret_cast<char*>(arena.Push(segment.length, 1));
+					size_t keyLength = 0;
+
+					for (size_t idx = 0; idx < segment.length; ++idx)
+					{
+						char c = segment.data[idx];
+						if (c == '~')
+						{
+							char escaped = idx + 1 < segment.length ? segment.data[idx + 1] : '\0';
+							if (escaped != '0' && escaped != '1')
+							{
+								// Invalid escape sequence
+								arena.SetMarker(marker);
+								return false;
+							}
+
+							c = escaped == '0' ? '~' : '/';
+							idx += 1;
+						}
+
+						key[keyLength] = c;
+						keyLength += 1;
+					}
+
+					step.key = String(key, keyLength);
+				}
+
+				step.hash = StringHash(step.key);
+
+				// JSON Pointer indices are "0" or have no leading zero, anything else only matches object keys
+				uint64 index;
+				if (isPointer && step.key == "-")
+				{
+					step.index = JsonQueryEndIndex;
+				}
+				else if (step.key.length > 0 && IsDigit(step.key.data[0]) && (!isPointer || step.key.length == 1 || step.key.data[0] != '0') &&
+					step.key.Parse(index) && index < JsonQueryEndIndex)
+				{
+					step.index = static_cast<size_t>(index);
+				}
+			}
+
+			if (delimiterIdx != SIZE_MAX)
+			{
+				path = path.Slice(delimiterIdx + 1);
+			}
+		}
+
+		query.steps = TSpan(steps, stepCount);
+
+		return true;
+	}
+
+	static JsonValue* FindJsonValueInStep(JsonValue* value, const JsonQueryStep& step)
+	{
+		if (value->type == JsonType::Array && step.index != SIZE_MAX)
+		{
+			return FindJsonValueInArray(value, step.index);
+		}
+
+		if (value->type != JsonType::Object || value->children < 2)
+		{
+			return nullptr;
+		}
+
+		JsonValue* child = value + 1;
+		while (child && child->sibling)
+		{
+			if (child->hash == step.hash && child->value == step.key)
+			{
+				return child->sibling;
+			}
+
+			child = child->sibling->sibling;
+		}
+
+		return nullptr;
+	}
+
+	// Recurses once per nesting level and branching step, ParseJson keeps the former within JsonMaxDepth
+	static size_t MatchJsonQuery(JsonValue* value, TSpan<JsonQueryStep> steps, TSpan<JsonValue*> results, size_t resultCount)
+	{
+		for (size_t stepIdx = 0; value && stepIdx < steps.length; ++stepIdx)
+		{
+			const JsonQueryStep& step = steps.data[stepIdx];
+			if (step.type == JsonQueryStepType::Key)
+			{
+				value = FindJsonValueInStep(value, step);
+				continue;
+			}
+
+			// Branching steps fan out over the children, matching the remaining steps against each of them
+			TSpan<JsonQueryStep> remainingSteps(steps.data + stepIdx + 1, steps.length - stepIdx - 1);
+
+			if (step.type == JsonQueryStepType::Descendant)
+			{
+				resultCount = MatchJsonQuery(value, remainingSteps, results, resultCount);
+
+				// Keep the descendant step for the children so it applies at every depth
+				remainingSteps = TSpan(steps.data + stepIdx, steps.length - stepIdx);
+			}
+
+			if (value->type == JsonType::Array || value->type == JsonType::Object)
+			{
+				const bool isObject = value->type == JsonType::Object;
+
+				JsonValue* child = value->children > 0 ? value + 1 : nullptr;
+				while (child && resultCount < results.length)
+				{
+					// Object children alternate between keys and values
+					JsonValue* childValue = isObject ? child->sibling : child;
+					if (!childValue)
+					{
+						break;
+					}
+
+					resultCount = MatchJsonQuery(childValue, remainingSteps, results, resultCount);
+					child = childValue->sibling;
+				}
+			}
+
+			return resultCount;
+		}
+
+		if (value && resultCount < results.length)
+		{
+			results.data[resultCount] = value;
+			resultCount += 1;
+		}
+
+		return resultCount;
+	}
+
+	JsonValue* FindJsonValue(JsonValue* value, const JsonQuery& query)
+	{
+		JsonValue* result = nullptr;
+		FindJsonValues(value, query, TSpan(&result, 1));
+
+		return result;
+	}
+
+	size_t FindJsonValues(JsonValue* value, const JsonQuery& query, TSpan<JsonValue*> results)
+	{
+		if (!value || results.length == 0)
+		{
+			return 0;
+		}
+
+		return MatchJsonQuery(value, query.steps, results, 0);
+	}
+
+	static bool DecodeJsonField(JsonValue* value, const JsonField& field, uint8* result)
+	{
+		uint8* member = result + field.offset;
+
+		switch (field.type)
+		{
+			case JsonFieldType::Bool:
+				if (value->type != JsonType::Bool)
+				{
+					return false;
+				}
+
+				*reinterpret_cast<bool*>(member) = value->asBool;
+				return true;
+
+			case JsonFieldType::Int32: return value->type == JsonType::Number && value->value.Parse(*reinterpret_cast<int32*>(member));
+			case JsonFieldType::Uint32: return value->type == JsonType::Number && value->value.Parse(*reinterpret_cast<uint32*>(member));
+			case JsonFieldType::Int64: return value->type == JsonType::Number && value->value.Parse(*reinterpret_cast<int64*>(member));
+			case JsonFieldType::Uint64: return value->type == JsonType::Number && value->value.Parse(*reinterpret_cast<uint64*>(member));
+
+			case JsonFieldType::Float:
+				if (value->type != JsonType::Number)
+				{
+					return false;
+				}
+
+				*reinterpret_cast<float*>(member) = static_cast<float>(value->asNumber);
+				return true;
+
+			case JsonFieldType::Double:
+				if (value->type != JsonType::Number)
+				{
+					return false;
+				}
+
+				*reinterpret_cast<double*>(member) = value->asNumber;
+				return true;
+
+			case JsonFieldType::String:
+				if (value->type != JsonType::String)
+				{
+					return false;
+				}
+
+				*reinterpret_cast<String*>(member) = value->value;
+				return true;
+
+			case JsonFieldType::Object:
+				BK_ASSERT(field.schema);
+				return DecodeJson(value, *field.schema, member);
+		}
+
+		return false;
+	}
+
+	bool DecodeJson(JsonValue* object, const JsonSchema& schema, void* result)
+	{
+		if (!object || object->type != JsonType::Object)
+		{
+			return false;
+		}
+
+		bool success = true;
+
+		JsonValue* key = object->children > 0 ? object + 1 : nullptr;
+		while (key && key->sibling)
+		{
+			JsonValue* value = key->sibling;
+
+			uint8 fieldIdx = schema.slots[schema.GetSlot(key->hash)];
+			if (fieldIdx != UINT8_MAX)
+			{
+				const JsonField& field = schema.fields[fieldIdx];
+				if (field.hash == key->hash && field.name == key->value)
+				{
+					success &= DecodeJsonField(value, field, static_cast<uint8*>(result));
+				}
+			}
+
+			key = value->sibling;
+		}
+
+		return success;
+	}
+
+	bool EncodeJson(StringBuffer& buffer, const JsonSchema& schema, const void* object)
+	{
+		bool success = buffer.Append('{');
+
+		for (size_t fieldIdx = 0; fieldIdx < schema.fieldCount && success; ++fieldIdx)
+		{
+			const JsonField& field = schema.fields[fieldIdx];
+			const uint8* member = static_cast<const uint8*>(object) + field.offset;
+
+			if (fieldIdx > 0)
+			{
+				success &= buffer.Append(',');
+			}
+
+			success &= buffer.Appendf("\"%.*s\":", static_cast<int32>(field.name.length), field.name.data);
+
+			switch (field.type)
+			{
+				case JsonFieldType::Bool: success &= buffer.Append(*reinterpret_cast<const bool*>(member) ? "true" : "false"); break;
+				case JsonFieldType::Int32: success &= buffer.Appendf("%d", *reinterpret_cast<const int32*>(member)); break;
+				case JsonFieldType::Uint32: success &= buffer.Appendf("%u", *reinterpret_cast<const uint32*>(member)); break;
+				case JsonFieldType::Int64: success &= buffer.Appendf("%lld", static_cast<long long>(*reinterpret_cast<const int64*>(member))); break;
+				case JsonFieldType::Uint64: success &= buffer.Appendf("%llu", static_cast<unsigned long long>(*reinterpret_cast<const uint64*>(member))); break;
+				case JsonFieldType::Float: success &= buffer.Appendf("%.9g", static_cast<double>(*reinterpret_cast<const float*>(member))); break;
+				case JsonFieldType::Double: success &= buffer.Appendf("%.17g", *reinterpret_cast<const double*>(member)); break;
+
+				case JsonFieldType::String:
+				{
+					const String& string = *reinterpret_cast<const String*>(member);
+					success &= buffer.Append('"') && buffer.Append(string) && buffer.Append('"');
+					break;
+				}
+
+				case JsonFieldType::Object:
+					BK_ASSERT(field.schema);
+					success &= EncodeJson(buffer, *field.schema, member);
+					break;
+			}
+		}
+
+		return success && buffer.Append('}');
+	}
 }
@@ -1,11 +1,19 @@
 #pragma once
 
 #include "BkCore.h"
+#include "BkSpan.h"
 #include "BkString.h"
 
+#define BK_JSON_FIELD(StructType, member, fieldType) \
+	Bk::JsonField { .name = #member, .offset = offsetof(StructType, member), .type = Bk::JsonFieldType::fieldType }
+
+#define BK_JSON_OBJECT_FIELD(StructType, member, memberSchema) \
+	Bk::JsonField { .name = #member, .offset = offsetof(StructType, member), .type = Bk::JsonFieldType::Object, .schema = &(memberSchema) }
+
 namespace Bk
 {
 	struct Arena;
+	struct StringBuffer;
 
 	enum class JsonType : uint8
 	{
@@ -20,6 +28,7 @@ namespace Bk
 	struct JsonValue
 	{
 		JsonType type;
+		uint32 hash; // StringHash of value, only set for object keys
 		String value;
 		JsonValue* parent;
 		JsonValue* sibling;
@@ -32,8 +41,185 @@ namespace Bk
 		};
 	};
 
-	JsonValue* ParseJson(Arena& arena, String json);
+	enum class JsonError : uint8
+	{
+		None,
+		UnexpectedEnd,
+		UnexpectedCharacter,
+		TrailingCharacters,
+		TrailingComma,
+		MissingComma,
+		MissingColon,
+		MismatchedBracket,
+		InvalidLiteral,
+		InvalidNumber,
+		InvalidEscape,
+		ControlCharacter,
+		TooDeep,
+	};
+
+	struct JsonParseResult
+	{
+		JsonError error;
+		size_t offset;
+		uint32 line;
+		uint32 column;
+	};
+
+	enum class JsonQueryStepType : uint8
+	{
+		Key,        // Object key, or array index if the key is numeric
+		Wildcard,   // Every child of an object or array ("*")
+		Descendant, // The current value and all of its descendants ("**")
+	};
+
+	// Index of "-" in a JSON Pointer, the element past the end of an array, which never exists when looking values up
+	constexpr size_t JsonQueryEndIndex = SIZE_MAX - 1;
+
+	struct JsonQueryStep
+	{
+		JsonQueryStepType type;
+		uint32 hash;
+		String key;
+		size_t index; // SIZE_MAX if the key can't be an array index
+	};
+
+	// Path compiled once into steps, to be reused across many lookups.
+	// Paths starting with '/' use JSON Pointer (RFC 6901) syntax, otherwise segments are separated by '.'
+	struct JsonQuery
+	{
+		TSpan<JsonQueryStep> steps;
+	};
+
+	// Deepest nesting of arrays and objects ParseJson accepts. Everything walking a parsed tree recursively (queries,
+	// the cache writer) relies on it to stay within a small stack
+	constexpr uint32 JsonMaxDepth = 256;
+
+	// Strict RFC 8259 parse, on failure returns nullptr and fills in the optional result with the error's location
+	JsonValue* ParseJson(Arena& arena, String json, JsonParseResult* result = nullptr);
+	const char* GetJsonErrorString(JsonError error);
+
 	JsonValue* FindJsonValue(JsonValue* value, String path);
 	JsonValue* FindJsonValueInObject(JsonValue* object, String key);
 	JsonValue* FindJsonValueInArray(JsonValue* array, size_t index);
+
+	bool CompileJsonQuery(Arena& arena, String path, JsonQuery& query);
+	JsonValue* FindJsonValue(JsonValue* value, const JsonQuery& query);
+
+	// Returns the number of matches written to results, stopping once it is full
+	size_t FindJsonValues(JsonValue* value, const JsonQuery& query, TSpan<JsonValue*> results);
+
+	enum class JsonFieldType : uint8
+	{
+		Bool,
+		Int32,
+		Uint32,
+		Int64,
+		Uint64,
+		Float,
+		Double,
+		String, // Raw view into the JSON source, escape sequences are kept as-is
+		Object,
+	};
+
+	struct JsonSchema;
+
+	struct JsonField
+	{
+		String name;
+		size_t offset;
+		JsonFieldType type;
+		const JsonSchema* schema;
+		uint32 hash;
+	};
+
+	// Runtime view of a TJsonSchema, field lookup goes through a perfect hash of the key's StringHash
+	struct JsonSchema
+	{
+		constexpr uint32 GetSlot(uint32 hash) const;
+
+		const JsonField* fields;
+		size_t fieldCount;
+		const uint8* slots;
+		uint32 slotShift;
+		uint32 seed;
+	};
+
+	// Field table with its perfect hash built at compile time, e.g.
+	// static constexpr TJsonSchema configSchema({ BK_JSON_FIELD(Config, width, Uint32), ... });
+	template<size_t FieldCount>
+	struct TJsonSchema : JsonSchema
+	{
+		static_assert(FieldCount > 0 && FieldCount < UINT8_MAX, "Schema field count out of range");
+
+		static constexpr uint32 SlotBits = static_cast<uint32>(64 - __builtin_clzll(FieldCount * 2));
+
+		constexpr TJsonSchema(const JsonField (&fields)[FieldCount]);
+
+		// The base points into this object's own storage, a copy would keep pointing into the source
+		TJsonSchema(const TJsonSchema&) = delete;
+		TJsonSchema& operator=(const TJsonSchema&) = delete;
+
+		JsonField fieldStorage[FieldCount];
+		uint8 slotStorage[1u << SlotBits];
+	};
+
+	// Decodes the object's members into the struct in a single pass, members without a matching field are skipped.
+	// Returns false if the value isn't an object or a matching member couldn't be converted to its field's type
+	bool DecodeJson(JsonValue* object, const JsonSchema& schema, void* result);
+	bool EncodeJson(StringBuffer& buffer, const JsonSchema& schema, const void* object);
+}
+
+namespace Bk
+{
+	constexpr uint32 JsonSchema::GetSlot(uint32 hash) const
+	{
+		return ((hash ^ seed) * 0x9E3779B1u) >> slotShift;
+	}
+
+	template<size_t FieldCount>
+	constexpr TJsonSchema<FieldCount>::TJsonSchema(const JsonField (&fields)[FieldCount])
+		: JsonSchema(), fieldStorage(), slotStorage()
+	{
+		constexpr uint32 slotCount = 1u << SlotBits;
+
+		for (size_t fieldIdx = 0; fieldIdx < FieldCount; ++fieldIdx)
+		{
+			fieldStorage[fieldIdx] = fields[fieldIdx];
+			fieldStorage[fieldIdx].hash = StringHash(fields[fieldIdx].name);
+		}
+
+		this->fields = fieldStorage;
+		this->fieldCount = FieldCount;
+		this->slots = slotStorage;
+		this->slotShift = 32 - SlotBits;
+
+		// Search for a seed that maps every field to its own slot, with at least twice as many slots as fields this
+		// takes a handful of attempts. Duplicate field names never resolve and fail the constant evaluation
+		for (uint32 seed = 0; seed < UINT16_MAX; ++seed)
+		{
+			this->seed = seed;
+
+			for (uint32 slotIdx = 0; slotIdx < slotCount; ++slotIdx)
+			{
+				slotStorage[slotIdx] = UINT8_MAX;
+			}
+
+			bool collision = false;
+			for (size_t fieldIdx = 0; fieldIdx < FieldCount && !collision; ++fieldIdx)
+			{
+				uint8& slot = slotStorage[GetSlot(fieldStorage[fieldIdx].hash)];
+
+				collision = slot != UINT8_MAX;
+				slot = static_cast<uint8>(fieldIdx);
+			}
+
+			if (!collision)
+			{
+				return;
+			}
+		}
+
+		FatalError(1, "Failed to build perfect hash for JSON schema");
+	}
 }
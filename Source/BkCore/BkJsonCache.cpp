@@ -0,0 +1,434 @@
+#include "BkJsonCache.h"
+
+#include "BkArena.h"
+#include "BkFile.h"
+#include "BkMemory.h"
+
+namespace Bk
+{
+	static_assert(sizeof(JsonCacheHeader) % alignof(JsonCacheValue) == 0, "Cache values must be aligned after the header");
+
+	struct JsonCacheString
+	{
+		uint32 hash;
+		uint32 offset;
+		String value;
+	};
+
+	struct JsonCacheWriter
+	{
+		JsonCacheValue* values;
+		uint32 valueCount;
+
+		char* strings;
+		uint32 stringsSize;
+
+		JsonCacheString* internTable;
+		uint32 internMask;
+	};
+
+	static void CountJsonValues(JsonValue* value, uint32& valueCount, size_t& stringsSize)
+	{
+		valueCount += 1;
+
+		if (value->type == JsonType::String || value->type == JsonType::Number)
+		{
+			stringsSize += value->value.length;
+		}
+
+		if (value->type == JsonType::Object || value->type == JsonType::Array)
+		{
+			JsonValue* child = value->children > 0 ? value + 1 : nullptr;
+			for (; child; child = child->sibling)
+			{
+				CountJsonValues(child, valueCount, stringsSize);
+			}
+		}
+	}
+
+	static uint32 InternJsonString(JsonCacheWriter& writer, String string, uint32 hash)
+	{
+		for (uint32 slot = hash & writer.internMask;; slot = (slot + 1) & writer.internMask)
+		{
+			JsonCacheString& entry = writer.internTable[slot];
+			if (entry.value.data == nullptr)
+			{
+				entry.hash = hash;
+				entry.offset = writer.stringsSize;
+				entry.value = string;
+
+				MemoryCopy(writer.strings + writer.stringsSize, string.data, string.length);
+				writer.stringsSize += static_cast<uint32>(string.length);
+
+				return entry.offset;
+			}
+
+			if (entry.hash == hash && entry.value == string)
+			{
+				return entry.offset;
+			}
+		}
+	}
+
+	static uint32 WriteJsonValue(JsonCacheWriter& writer, JsonValue* value)
+	{
+		uint32 valueIdx = writer.valueCount;
+		writer.valueCount += 1;
+
+		JsonCacheValue& result = writer.values[valueIdx];
+		result.type = value->type;
+
+		switch (value->type)
+		{
+			case JsonType::Null:
+				break;
+
+			case JsonType::Bool:
+				result.asBool = value->asBool;
+				break;
+
+			case JsonType::Number:
+			case JsonType::String:
+			{
+				// Parsing only hashes object keys, every string is interned here so they all need one
+				uint32 hash = StringHash(value->value);
+
+				// Temporarily store the offset into the string table, it's made relative once the layout is final
+				result.hash = value->type == JsonType::String ? hash : 0;
+				result.valueOffset = InternJsonString(writer, value->value, hash);
+				result.valueLength = static_cast<uint32>(value->value.length);
+				result.asNumber = value->type == JsonType::Number ? value->asNumber : 0.0;
+				break;
+			}
+
+			case JsonType::Array:
+			case JsonType::Object:
+			{
+				result.children = static_cast<uint32>(value->children);
+
+				uint32 previousIdx = 0;
+
+				JsonValue* child = value->children > 0 ? value + 1 : nullptr;
+				for (; child; child = child->sibling)
+				{
+					uint32 childIdx = WriteJsonValue(writer, child);
+					if (previousIdx)
+					{
+						writer.values[previousIdx].sibling = childIdx - previousIdx;
+					}
+
+					previousIdx = childIdx;
+				}
+
+				break;
+			}
+		}
+
+		return valueIdx;
+	}
+
+	TSpan<uint8> WriteJsonCache(Arena& arena, JsonValue* root, uint64 contentHash)
+	{
+		if (!root)
+		{
+			return {};
+		}
+
+		uint32 valueCount = 0;
+		size_t stringsCapacity = 0;
+		CountJsonValues(root, valueCount, stringsCapacity);
+
+		if (stringsCapacity > UINT32_MAX)
+		{
+			return {};
+		}
+
+		ArenaMarker marker = arena.GetMarker();
+
+		size_t valuesOffset = sizeof(JsonCacheHeader);
+		size_t stringsOffset = valuesOffset + valueCount * sizeof(JsonCacheValue);
+
+		uint8* data = arena.PushZeroed(AlignUp(stringsOffset + stringsCapacity, 8), alignof(JsonCacheValue));
+
+		JsonCacheWriter writer = {};
+		writer.values = reinterpret_cast<JsonCacheValue*>(data + valuesOffset);
+		writer.strings = reinterpret_cast<char*>(data + stringsOffset);
+
+		// Interning table is only needed while writing, so it's released once the values have been written
+		uint32 internCapacity = 16;
+		while (internCapacity < valueCount * 2)
+		{
+			internCapacity *= 2;
+		}
+
+		ArenaMarker scratchMarker = arena.GetMarker();
+
+		writer.internTable = arena.PushZeroed<JsonCacheString>(internCapacity);
+		writer.internMask = internCapacity - 1;
+
+		WriteJsonValue(writer, root);
+
+		for (uint32 valueIdx = 0; valueIdx < writer.valueCount; ++valueIdx)
+		{
+			JsonCacheValue& value = writer.values[valueIdx];
+			if (value.type == JsonType::String || value.type == JsonType::Number)
+			{
+				size_t valueAddress = valuesOffset + valueIdx * sizeof(JsonCacheValue);
+				value.valueOffset = static_cast<uint32>(stringsOffset + value.valueOffset - valueAddress);
+			}
+		}
+
+		arena.SetMarker(scratchMarker);
+
+		size_t size = AlignUp(stringsOffset + writer.stringsSize, 8);
+		if (size > UINT32_MAX)
+		{
+			arena.SetMarker(marker);
+			return {};
+		}
+
+		JsonCacheHeader* header = reinterpret_cast<JsonCacheHeader*>(data);
+		header->magic = JsonCacheHeader::Magic;
+		header->version = JsonCacheHeader::Version;
+		header->contentHash = contentHash;
+		header->size = size;
+		header->valueCount = writer.valueCount;
+		header->stringsSize = writer.stringsSize;
+
+		return TSpan(data, size);
+	}
+
+	bool LoadJsonCache(TSpan<uint8> data, uint64 contentHash, JsonCache& cache)
+	{
+		cache = {};
+
+		if (data.length < sizeof(JsonCacheHeader) || reinterpret_cast<uintptr_t>(data.data) % alignof(JsonCacheValue) != 0)
+		{
+			return false;
+		}
+
+		const JsonCacheHeader* header = reinterpret_cast<const JsonCacheHeader*>(data.data);
+		if (header->magic != JsonCacheHeader::Magic || header->version != JsonCacheHeader::Version ||
+			header->contentHash != contentHash || header->size != data.length || header->valueCount == 0)
+		{
+			return false;
+		}
+
+		size_t stringsOffset = sizeof(JsonCacheHeader) + size_t(header->valueCount) * sizeof(JsonCacheValue);
+		if (stringsOffset + header->stringsSize > data.length)
+		{
+			return false;
+		}
+
+		const JsonCacheValue* values = reinterpret_cast<const JsonCacheValue*>(data.data + sizeof(JsonCacheHeader));
+
+		// The header can be intact while the body is corrupt or truncated, so every link the lookups follow is checked
+		// once here rather than on each access. Links only point forward, which keeps sibling walks finite
+		for (uint32 valueIdx = 0; valueIdx < header->valueCount; ++valueIdx)
+		{
+			const JsonCacheValue& value = values[valueIdx];
+
+			if (value.type > JsonType::Object || uint64(valueIdx) + value.sibling >= header->valueCount)
+			{
+				return false;
+			}
+
+			if ((value.type == JsonType::Array || value.type == JsonType::Object) && value.children > 0 &&
+				valueIdx + 1 >= header->valueCount)
+			{
+				return false;
+			}
+
+			if (value.type == JsonType::String || value.type == JsonType::Number)
+			{
+				uint64 valueStart = sizeof(JsonCacheHeader) + uint64(valueIdx) * sizeof(JsonCacheValue) + value.valueOffset;
+				if (valueStart < stringsOffset || valueStart + value.valueLength > stringsOffset + header->stringsSize)
+				{
+					return false;
+				}
+			}
+		}
+
+		cache.header = header;
+		cache.root = values;
+
+		return true;
+	}
+
+	static TSpan<uint8> MapJsonCacheFile(const char* path, FileMapFlags flags)
+	{
+		FileHandle file = OpenFile(path, FileAccess::Read);
+		TSpan<uint8> result = MapFile(file, flags);
+		CloseFile(file);
+
+		return result;
+	}
+
+	bool LoadJsonCached(Arena& arena, const char* path, const char* cacheDirectory, JsonCache& cache)
+	{
+		cache = {};
+
+		TSpan<uint8> json = MapJsonCacheFile(path, FileMapFlags::Sequential);
+		if (!json.data)
+		{
+			return false;
+		}
+
+		uint64 contentHash = MemoryHash(json.data, json.length);
+
+		// Named after the source path rather than its content, so each edit replaces the file instead of adding one.
+		// The content hash in the header tells whether it's stale
+		String sourcePath(path);
+		uint64 pathHash = MemoryHash(sourcePath.data, sourcePath.length);
+
+		TStringBuffer<1024> cachePath;
+		if (!cachePath.Appendf("%s/%016llx.bkjc", cacheDirectory, static_cast<unsigned long long>(pathHash)))
+		{
+			UnmapFile(json);
+			return false;
+		}
+
+		TSpan<uint8> cacheData = MapJsonCacheFile(cachePath.data, FileMapFlags::Random);
+		if (LoadJsonCache(cacheData, contentHash, cache))
+		{
+			cache.mapping = cacheData;
+
+			UnmapFile(json);
+			return true;
+		}
+
+		UnmapFile(cacheData);
+
+		// Missing or stale cache, parse the source and rebuild it. The parsed tree points into the source mapping and
+		// is only needed to write the cache, so it's built in a scratch arena and only the cache is kept
+		Arena scratch = { .tag = MemoryTag::Json };
+
+		JsonValue* root = ParseJson(scratch, String(reinterpret_cast<const char*>(json.data), json.length));
+		TSpan<uint8> builtData = WriteJsonCache(scratch, root, contentHash);
+
+		UnmapFile(json);
+
+		ArenaMarker marker = arena.GetMarker();
+
+		cacheData = {};
+		if (builtData.data)
+		{
+			cacheData = TSpan(arena.Push(builtData.length, alignof(JsonCacheValue)), builtData.length);
+			MemoryCopy(cacheData.data, builtData.data, builtData.length);
+		}
+
+		if (!LoadJsonCache(cacheData, contentHash, cache))
+		{
+			arena.SetMarker(marker);
+			scratch.SetMarker({});
+			return false;
+		}
+
+		// Replaced atomically so concurrent loads never map a partially written cache. It can be rebuilt, so it
+		// isn't worth a sync
+		AtomicFile cacheFile;
+		if (cacheFile.Begin(&scratch, cachePath.data, cacheData.length))
+		{
+			if (WriteFile(cacheFile.handle, cacheData) == cacheData.length)
+			{
+				cacheFile.Commit(false);
+			}
+			else
+			{
+				cacheFile.Abort();
+			}
+		}
+
+		scratch.SetMarker({});
+		return true;
+	}
+
+	void UnloadJsonCache(JsonCache& cache)
+	{
+		UnmapFile(cache.mapping);
+		cache = {};
+	}
+
+	String JsonCacheValue::GetValue() const
+	{
+		return String(reinterpret_cast<const char*>(this) + valueOffset, valueLength);
+	}
+
+	const JsonCacheValue* JsonCacheValue::GetSibling() const
+	{
+		return sibling ? this + sibling : nullptr;
+	}
+
+	const JsonCacheValue* FindJsonValue(const JsonCacheValue* value, String path)
+	{
+		while (value && path.length > 0)
+		{
+			size_t pathDelimIdx = path.Find('.');
+			String pathSlice = path.Range(0, pathDelimIdx);
+
+			uint64 index;
+			if (value->type == JsonType::Array && pathSlice.Parse(index))
+			{
+				value = FindJsonValueInArray(value, index);
+			}
+			else if (value->type == JsonType::Object)
+			{
+				value = FindJsonValueInObject(value, pathSlice);
+			}
+			else
+			{
+				value = nullptr;
+				break;
+			}
+
+			if (pathDelimIdx == SIZE_MAX)
+			{
+				break;
+			}
+
+			path = path.Slice(pathDelimIdx + 1);
+		}
+
+		return value;
+	}
+
+	const JsonCacheValue* FindJsonValueInObject(const JsonCacheValue* object, String key)
+	{
+		if (object->type != JsonType::Object || object->children < 2)
+		{
+			return nullptr;
+		}
+
+		uint32 hash = StringHash(key);
+
+		const JsonCacheValue* child = object + 1;
+		while (child && child->sibling)
+		{
+			const JsonCacheValue* value = child->GetSibling();
+			if (child->hash == hash && child->GetValue() == key)
+			{
+				return value;
+			}
+
+			child = value->GetSibling();
+		}
+
+		return nullptr;
+	}
+
+	const JsonCacheValue* FindJsonValueInArray(const JsonCacheValue* array, size_t index)
+	{
+		if (array->type != JsonType::Array || array->children <= index)
+		{
+			return nullptr;
+		}
+
+		const JsonCacheValue* child = array + 1;
+		for (size_t childIdx = 0; child && childIdx < index; ++childIdx)
+		{
+			child = child->GetSibling();
+		}
+
+		return child;
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "BkCore.h"
+#include "BkJson.h"
+#include "BkSpan.h"
+#include "BkString.h"
+
+namespace Bk
+{
+	struct Arena;
+
+	struct JsonCacheHeader
+	{
+		static constexpr uint32 Magic = 0x434A4B42; // 'BKJC'
+		static constexpr uint32 Version = 1;
+
+		uint32 magic;
+		uint32 version;
+		uint64 contentHash;
+		uint64 size;
+		uint32 valueCount;
+		uint32 stringsSize;
+	};
+
+	// Position-independent counterpart to JsonValue, values are stored in pre-order so a container's first child
+	// directly follows it. Links are relative, so the cache can be used straight from a mapped or loaded file.
+	// Only strings and numbers keep their source text, keys and strings are interned.
+	struct JsonCacheValue
+	{
+		String GetValue() const;
+		const JsonCacheValue* GetSibling() const;
+
+		JsonType type;
+		uint32 hash; // StringHash of value, only set for strings
+		uint32 children;
+		uint32 sibling; // Distance in values to the next sibling, 0 if last
+		uint32 valueOffset; // Distance in bytes to the value's text
+		uint32 valueLength;
+
+		union
+		{
+			bool asBool;
+			double asNumber;
+		};
+	};
+
+	struct JsonCache
+	{
+		const JsonCacheHeader* header;
+		const JsonCacheValue* root;
+		TSpan<uint8> mapping; // Set when loaded straight from a mapped cache file
+	};
+
+	TSpan<uint8> WriteJsonCache(Arena& arena, JsonValue* root, uint64 contentHash);
+	bool LoadJsonCache(TSpan<uint8> data, uint64 contentHash, JsonCache& cache);
+
+	// Loads the JSON file through a cache file named after its path, rebuilding it when it is missing or was built
+	// from different content. Only the cache is allocated from the arena. The cache directory is expected to exist
+	bool LoadJsonCached(Arena& arena, const char* path, const char* cacheDirectory, JsonCache& cache);
+	void UnloadJsonCache(JsonCache& cache);
+
+	const JsonCacheValue* FindJsonValue(const JsonCacheValue* value, String path);
+	const JsonCacheValue* FindJsonValueInObject(const JsonCacheValue* object, String key);
+	const JsonCacheValue* FindJsonValueInArray(const JsonCacheValue* array, size_t index);
+}
@@ -1,19 +1,825 @@
 #include "BkMemory.h"
 
+#include "BkString.h"
+
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(BK_SIZE_CLASS_ALLOCATOR)
+#if defined(BK_PLATFORM_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif !defined(BK_PLATFORM_EMSCRIPTEN)
+#include <sys/mman.h>
+#endif
+#endif
+
 namespace Bk
 {
-	void* MemoryAllocate(size_t size)
+#if defined(BK_SIZE_CLASS_ALLOCATOR)
+	// Sizes up to 128 bytes go in steps of 16, then four classes per power of two up to MemorySmallSizeMax
+	constexpr size_t MemorySmallSizeMax = BK_KILOBYTES(32);
+	constexpr uint32 MemorySizeClassCount = 40;
+
+	// Slabs are aligned to their size, so the slab of any small allocation is found by masking its address. They
+	// stay mapped for good, only the pages past MemorySlabKeptSize are handed back once a slab is empty
+	constexpr size_t MemorySlabSize = BK_KILOBYTES(256);
+	constexpr size_t MemorySlabHeaderSize = 128;
+	constexpr size_t MemorySlabKeptSize = BK_KILOBYTES(16);
+
+	// Partial slabs have room or are the current one, full ones don't. A free from another thread into a full slab
+	// flags it as ready and hands it to the owning heap, which moves it back to the partial list
+	constexpr uint32 MemorySlabPartial = 0;
+	constexpr uint32 MemorySlabFull = 1;
+	constexpr uint32 MemorySlabReady = 2;
+	constexpr uint32 MemorySlabReleased = 3;
+
+	struct MemoryHeap;
+
+	struct MemorySlab
+	{
+		MemoryHeap* owner; // Never changes, slabs move between threads along with their heap
+		MemorySlab* next;
+		MemorySlab* previous;
+		MemorySlab* readyNext;
+		void* freeList; // Only touched by the owner
+		void* remoteFreeList; // Pushed to by other threads, taken whole by the owner
+		uint32 sizeClass;
+		uint32 objectSize;
+		uint32 bumpOffset; // Start of the part of the slab that was never handed out
+		uint32 usedCount;
+		uint32 state;
+	};
+
+	static_assert(sizeof(MemorySlab) <= MemorySlabHeaderSize);
+
+	struct MemorySizeClass
+	{
+		MemorySlab* current;
+		MemorySlab* partial;
+		MemorySlab* full;
+	};
+
+	// One per thread. Heaps are never freed, the heap of a thread that exits is abandoned with all its slabs and
+	// taken over by the next thread that starts allocating
+	struct MemoryHeap
+	{
+		MemorySizeClass sizeClasses[MemorySizeClassCount];
+		MemorySlab* readySlabs; // Pushed to by other threads, taken whole by the owner
+		MemorySlab* releasedSlabs;
+		MemoryHeap* nextAbandoned;
+	};
+
+	struct MemoryHeapOwner
+	{
+		~MemoryHeapOwner();
+
+		MemoryHeap* heap;
+	};
+
+	struct MemoryAbandonedHeaps
+	{
+		uint32 lock;
+		MemoryHeap* heaps;
+	};
+
+	static thread_local MemoryHeapOwner memoryHeapOwner;
+	static MemoryAbandonedHeaps memoryAbandonedHeaps;
+
+	static uint32 GetMemorySizeClass(size_t size)
+	{
+		if (size <= 128)
+		{
+			return size > 0 ? static_cast<uint32>((size - 1) / 16) : 0;
+		}
+
+		uint32 shift = 63 - CountLeadingZeros(size - 1);
+		uint32 step = static_cast<uint32>((size - 1) >> (shift - 2)) & 3;
+
+		return 8 + (shift - 7) * 4 + step;
+	}
+
+	static uint32 GetMemorySizeClassSize(uint32 sizeClass)
+	{
+		if (sizeClass < 8)
+		{
+			return (sizeClass + 1) * 16;
+		}
+
+		uint32 shift = (sizeClass - 8) / 4 + 7;
+		uint32 step = (sizeClass - 8) % 4;
+
+		return (5 + step) << (shift - 2);
+	}
+
+	static void* AllocatePages(size_t size, size_t alignment)
+	{
+#if defined(BK_PLATFORM_WINDOWS)
+		if (alignment <= 1)
+		{
+			return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		}
+
+		// Reservations can't be trimmed, so find an aligned address in a larger one and map just that. Another thread
+		// can take the range in between, in which case we try again
+		for (;;)
+		{
+			void* reservation = VirtualAlloc(nullptr, size + alignment, MEM_RESERVE, PAGE_NOACCESS);
+			if (!reservation)
+			{
+				return nullptr;
+			}
+
+			void* aligned = reinterpret_cast<void*>(AlignUp(reinterpret_cast<uintptr_t>(reservation), alignment));
+			VirtualFree(reservation, 0, MEM_RELEASE);
+
+			void* result = VirtualAlloc(aligned, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+			if (result)
+			{
+				return result;
+			}
+		}
+#elif defined(BK_PLATFORM_EMSCRIPTEN)
+		return alignment > 1 ? aligned_alloc(alignment, size) : malloc(size);
+#else
+		// Over-allocate and trim both ends to get the alignment
+		size_t mappedSize = alignment > 1 ? size + alignment : size;
+		void* mapping = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mapping == MAP_FAILED)
+		{
+			return nullptr;
+		}
+
+		if (alignment <= 1)
+		{
+			return mapping;
+		}
+
+		uintptr_t start = reinterpret_cast<uintptr_t>(mapping);
+		uintptr_t alignedStart = AlignUp(start, alignment);
+
+		if (alignedStart > start)
+		{
+			munmap(mapping, alignedStart - start);
+		}
+
+		munmap(reinterpret_cast<void*>(alignedStart + size), start + mappedSize - (alignedStart + size));
+
+		return reinterpret_cast<void*>(alignedStart);
+#endif
+	}
+
+	static void DeallocatePages(void* ptr, size_t size)
+	{
+#if defined(BK_PLATFORM_WINDOWS)
+		VirtualFree(ptr, 0, MEM_RELEASE);
+#elif defined(BK_PLATFORM_EMSCRIPTEN)
+		free(ptr);
+#else
+		munmap(ptr, size);
+#endif
+	}
+
+	// Keeps the range mapped but lets the system take back its memory, the contents are lost
+	static void DiscardPages(void* ptr, size_t size)
+	{
+#if defined(BK_PLATFORM_WINDOWS)
+		VirtualAlloc(ptr, size, MEM_RESET, PAGE_READWRITE);
+#elif defined(BK_PLATFORM_EMSCRIPTEN)
+		// Wasm memory can't shrink
+#else
+		madvise(ptr, size, MADV_DONTNEED);
+#endif
+	}
+
+	static void PushSlab(MemorySlab*& list, MemorySlab* slab)
+	{
+		slab->previous = nullptr;
+		slab->next = list;
+
+		if (list)
+		{
+			list->previous = slab;
+		}
+
+		list = slab;
+	}
+
+	static void UnlinkSlab(MemorySlab*& list, MemorySlab* slab)
+	{
+		if (slab->previous)
+		{
+			slab->previous->next = slab->next;
+		}
+		else
+		{
+			list = slab->next;
+		}
+
+		if (slab->next)
+		{
+			slab->next->previous = slab->previous;
+		}
+
+		slab->next = nullptr;
+		slab->previous = nullptr;
+	}
+
+	// Moves frees from other threads over to the owner's list
+	static void CollectRemoteFrees(MemorySlab* slab)
+	{
+		if (!__atomic_load_n(&slab->remoteFreeList, __ATOMIC_RELAXED))
+		{
+			return;
+		}
+
+		void* remote = __atomic_exchange_n(&slab->remoteFreeList, nullptr, __ATOMIC_ACQUIRE);
+		while (remote)
+		{
+			void* next = *static_cast<void**>(remote);
+
+			*static_cast<void**>(remote) = slab->freeList;
+			slab->freeList = remote;
+			slab->usedCount -= 1;
+
+			remote = next;
+		}
+	}
+
+	static bool HasFreeObjects(const MemorySlab* slab)
+	{
+		return slab->freeList || slab->bumpOffset + slab->objectSize <= MemorySlabSize;
+	}
+
+	// Only called for empty slabs that aren't on any list. Frees from other threads may still be reading the header
+	// after their last push, so it stays in place
+	static void ReleaseSlab(MemoryHeap& heap, MemorySlab* slab)
+	{
+		__atomic_store_n(&slab->state, MemorySlabReleased, __ATOMIC_RELAXED);
+		DiscardPages(reinterpret_cast<uint8*>(slab) + MemorySlabKeptSize, MemorySlabSize - MemorySlabKeptSize);
+
+		slab->next = heap.releasedSlabs;
+		heap.releasedSlabs = slab;
+	}
+
+	static void RetireFullSlab(MemorySizeClass& slabClass, MemorySlab* slab)
+	{
+		PushSlab(slabClass.full, slab);
+		__atomic_store_n(&slab->state, MemorySlabFull, __ATOMIC_SEQ_CST);
+
+		// A free from another thread that landed before the slab was marked full didn't flag it
+		if (__atomic_load_n(&slab->remoteFreeList, __ATOMIC_SEQ_CST))
+		{
+			uint32 expected = MemorySlabFull;
+			if (__atomic_compare_exchange_n(&slab->state, &expected, MemorySlabPartial, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			{
+				UnlinkSlab(slabClass.full, slab);
+				PushSlab(slabClass.partial, slab);
+			}
+		}
+	}
+
+	// Full slabs that other threads freed into since the last refill
+	static void CollectReadySlabs(MemoryHeap& heap)
+	{
+		if (!__atomic_load_n(&heap.readySlabs, __ATOMIC_RELAXED))
+		{
+			return;
+		}
+
+		MemorySlab* slab = __atomic_exchange_n(&heap.readySlabs, nullptr, __ATOMIC_ACQUIRE);
+		while (slab)
+		{
+			MemorySlab* next = slab->readyNext;
+			MemorySizeClass& slabClass = heap.sizeClasses[slab->sizeClass];
+
+			__atomic_store_n(&slab->state, MemorySlabPartial, __ATOMIC_RELAXED);
+			UnlinkSlab(slabClass.full, slab);
+			CollectRemoteFrees(slab);
+
+			if (slab->usedCount == 0)
+			{
+				ReleaseSlab(heap, slab);
+			}
+			else
+			{
+				PushSlab(slabClass.partial, slab);
+			}
+
+			slab = next;
+		}
+	}
+
+	static MemorySlab* AcquireSlab(MemoryHeap& heap, uint32 sizeClass)
+	{
+		MemorySlab* slab = heap.releasedSlabs;
+		if (slab)
+		{
+			heap.releasedSlabs = slab->next;
+		}
+		else
+		{
+			slab = static_cast<MemorySlab*>(AllocatePages(MemorySlabSize, MemorySlabSize));
+			if (!slab)
+			{
+				return nullptr;
+			}
+
+			slab->owner = &heap;
+			slab->remoteFreeList = nullptr;
+		}
+
+		slab->next = nullptr;
+		slab->previous = nullptr;
+		slab->readyNext = nullptr;
+		slab->freeList = nullptr;
+		slab->sizeClass = sizeClass;
+		slab->objectSize = GetMemorySizeClassSize(sizeClass);
+		slab->bumpOffset = MemorySlabHeaderSize;
+		slab->usedCount = 0;
+		__atomic_store_n(&slab->state, MemorySlabPartial, __ATOMIC_RELAXED);
+
+		return slab;
+	}
+
+	// Finds the heap a slab with room for another object. Full slabs are kept off the partial list, so this doesn't
+	// get slower with the number of them
+	static MemorySlab* RefillSizeClass(MemoryHeap& heap, uint32 sizeClass)
+	{
+		CollectReadySlabs(heap);
+
+		MemorySizeClass& slabClass = heap.sizeClasses[sizeClass];
+
+		if (MemorySlab* current = slabClass.current)
+		{
+			CollectRemoteFrees(current);
+			if (HasFreeObjects(current))
+			{
+				return current;
+			}
+
+			slabClass.current = nullptr;
+			RetireFullSlab(slabClass, current);
+		}
+
+		while (MemorySlab* slab = slabClass.partial)
+		{
+			UnlinkSlab(slabClass.partial, slab);
+			CollectRemoteFrees(slab);
+
+			if (HasFreeObjects(slab))
+			{
+				slabClass.current = slab;
+				return slab;
+			}
+
+			RetireFullSlab(slabClass, slab);
+		}
+
+		slabClass.current = AcquireSlab(heap, sizeClass);
+
+		return slabClass.current;
+	}
+
+	static MemoryHeap* GetMemoryHeap()
+	{
+		MemoryHeap* heap = memoryHeapOwner.heap;
+		if (heap)
+		{
+			return heap;
+		}
+
+		while (__atomic_exchange_n(&memoryAbandonedHeaps.lock, 1u, __ATOMIC_ACQUIRE))
+		{
+		}
+
+		heap = memoryAbandonedHeaps.heaps;
+		if (heap)
+		{
+			memoryAbandonedHeaps.heaps = heap->nextAbandoned;
+		}
+
+		__atomic_store_n(&memoryAbandonedHeaps.lock, 0u, __ATOMIC_RELEASE);
+
+		if (!heap)
+		{
+			heap = static_cast<MemoryHeap*>(AllocatePages(sizeof(MemoryHeap), 1));
+			if (!heap)
+			{
+				return nullptr;
+			}
+
+			MemoryZero(heap, sizeof(MemoryHeap));
+		}
+
+		memoryHeapOwner.heap = heap;
+
+		return heap;
+	}
+
+	MemoryHeapOwner::~MemoryHeapOwner()
+	{
+		if (!heap)
+		{
+			return;
+		}
+
+		// Frees that still come in for the heap's slabs all go to their remote lists until it's taken over
+		CollectReadySlabs(*heap);
+
+		while (__atomic_exchange_n(&memoryAbandonedHeaps.lock, 1u, __ATOMIC_ACQUIRE))
+		{
+		}
+
+		heap->nextAbandoned = memoryAbandonedHeaps.heaps;
+		memoryAbandonedHeaps.heaps = heap;
+
+		__atomic_store_n(&memoryAbandonedHeaps.lock, 0u, __ATOMIC_RELEASE);
+
+		heap = nullptr;
+	}
+
+	static void* AllocateUntracked(size_t size)
+	{
+		if (size > MemorySmallSizeMax)
+		{
+			return AllocatePages(size, 1);
+		}
+
+		MemoryHeap* heap = GetMemoryHeap();
+		if (!heap)
+		{
+			return nullptr;
+		}
+
+		uint32 sizeClass = GetMemorySizeClass(size);
+
+		MemorySlab* slab = heap->sizeClasses[sizeClass].current;
+		if (!slab || !HasFreeObjects(slab))
+		{
+			slab = RefillSizeClass(*heap, sizeClass);
+			if (!slab)
+			{
+				return nullptr;
+			}
+		}
+
+		void* result = slab->freeList;
+		if (result)
+		{
+			slab->freeList = *static_cast<void**>(result);
+		}
+		else
+		{
+			result = reinterpret_cast<uint8*>(slab) + slab->bumpOffset;
+			slab->bumpOffset += slab->objectSize;
+		}
+
+		slab->usedCount += 1;
+
+		return result;
+	}
+
+	static void DeallocateUntracked(void* ptr, size_t size)
+	{
+		if (!ptr)
+		{
+			return;
+		}
+
+		if (size > MemorySmallSizeMax)
+		{
+			DeallocatePages(ptr, size);
+			return;
+		}
+
+		MemorySlab* slab = reinterpret_cast<MemorySlab*>(reinterpret_cast<uintptr_t>(ptr) & ~(MemorySlabSize - 1));
+		BK_ASSERTF(slab->sizeClass == GetMemorySizeClass(size), "Deallocated with a different size than allocated");
+
+		MemoryHeap* heap = memoryHeapOwner.heap;
+		if (slab->owner == heap)
+		{
+			*static_cast<void**>(ptr) = slab->freeList;
+			slab->freeList = ptr;
+			slab->usedCount -= 1;
+
+			MemorySizeClass& slabClass = heap->sizeClasses[slab->sizeClass];
+			if (slab == slabClass.current)
+			{
+				return;
+			}
+
+			// Ready slabs are moved by the next refill
+			uint32 expected = MemorySlabFull;
+			if (__atomic_compare_exchange_n(&slab->state, &expected, MemorySlabPartial, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			{
+				UnlinkSlab(slabClass.full, slab);
+				PushSlab(slabClass.partial, slab);
+			}
+			else if (expected != MemorySlabPartial)
+			{
+				return;
+			}
+
+			// The current slab stays as a reserve, any other slab that empties is released
+			if (slab->usedCount == 0 && !__atomic_load_n(&slab->remoteFreeList, __ATOMIC_RELAXED))
+			{
+				UnlinkSlab(slabClass.partial, slab);
+				ReleaseSlab(*heap, slab);
+			}
+
+			return;
+		}
+
+		void* head = __atomic_load_n(&slab->remoteFreeList, __ATOMIC_RELAXED);
+		do
+		{
+			*static_cast<void**>(ptr) = head;
+		} while (!__atomic_compare_exchange_n(&slab->remoteFreeList, &head, ptr, true, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+
+		// Pairs with the check in RetireFullSlab, either the owner sees this free or we see the slab marked full
+		uint32 expected = MemorySlabFull;
+		if (__atomic_load_n(&slab->state, __ATOMIC_SEQ_CST) == MemorySlabFull &&
+			__atomic_compare_exchange_n(&slab->state, &expected, MemorySlabReady, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		{
+			MemoryHeap* owner = slab->owner;
+
+			MemorySlab* readyHead = __atomic_load_n(&owner->readySlabs, __ATOMIC_RELAXED);
+			do
+			{
+				slab->readyNext = readyHead;
+			} while (!__atomic_compare_exchange_n(&owner->readySlabs, &readyHead, slab, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+		}
+	}
+#else
+	static void* AllocateUntracked(size_t size)
 	{
 		return malloc(size);
 	}
 
-	void MemoryDeallocate(void* ptr, size_t size)
+	static void DeallocateUntracked(void* ptr, size_t size)
 	{
 		free(ptr);
 	}
+#endif
+
+#if defined(BK_MEMORY_TRACKING)
+	// Site 0 collects whatever doesn't fit in the table
+	constexpr uint32 MemorySiteCapacity = 4096;
+
+	struct MemoryTrackingHeader
+	{
+		uint32 siteIdx;
+		MemoryTag tag;
+		uint8 padding[11]; // Keeps the allocation as aligned as the allocator made it
+	};
+
+	static_assert(sizeof(MemoryTrackingHeader) == 16);
+
+	struct MemorySiteStats
+	{
+		const char* file; // Written last, so a site is complete once its file is visible
+		uint32 line;
+		MemoryTag tag;
+		size_t liveBytes;
+		size_t liveCount;
+		size_t totalCount;
+	};
+
+	struct MemoryTracking
+	{
+		MemoryTagStats tags[static_cast<uint32>(MemoryTag::Count)];
+		MemorySiteStats sites[MemorySiteCapacity];
+		uint32 siteLock; // Only taken to add a site
+	};
+
+	static MemoryTracking memoryTracking;
+
+	static uint32 FindMemorySite(MemorySite site, MemoryTag tag)
+	{
+		uint64 key = reinterpret_cast<uintptr_t>(site.file) ^ (uint64(site.line) << 8) ^ static_cast<uint64>(tag);
+		uint32 hash = static_cast<uint32>(MemoryHash(&key, sizeof(key)));
+
+		// Sites are never removed, so a probe that reaches an empty slot can stop there
+		for (uint32 probeIdx = 0; probeIdx < MemorySiteCapacity - 1; ++probeIdx)
+		{
+			uint32 siteIdx = 1 + (hash + probeIdx) % (MemorySiteCapacity - 1);
+			MemorySiteStats& stats = memoryTracking.sites[siteIdx];
+
+			const char* file = __atomic_load_n(&stats.file, __ATOMIC_ACQUIRE);
+			if (file == site.file && stats.line == site.line && stats.tag == tag)
+			{
+				return siteIdx;
+			}
+
+			if (!file)
+			{
+				while (__atomic_exchange_n(&memoryTracking.siteLock, 1u, __ATOMIC_ACQUIRE))
+				{
+				}
+
+				// Another thread may have filled the slot while we waited
+				file = __atomic_load_n(&stats.file, __ATOMIC_RELAXED);
+				if (!file)
+				{
+					stats.line = site.line;
+					stats.tag = tag;
+					__atomic_store_n(&stats.file, site.file, __ATOMIC_RELEASE);
+				}
+
+				__atomic_store_n(&memoryTracking.siteLock, 0u, __ATOMIC_RELEASE);
+
+				if (!file || (file == site.file && stats.line == site.line && stats.tag == tag))
+				{
+					return siteIdx;
+				}
+			}
+		}
+
+		return 0;
+	}
+
+	void* MemoryAllocate(size_t size, MemoryTag tag, MemorySite site)
+	{
+		uint8* memory = static_cast<uint8*>(AllocateUntracked(size + sizeof(MemoryTrackingHeader)));
+		if (!memory)
+		{
+			return nullptr;
+		}
+
+		MemoryTrackingHeader* header = reinterpret_cast<MemoryTrackingHeader*>(memory);
+		header->siteIdx = FindMemorySite(site, tag);
+		header->tag = tag;
+
+		MemoryTagStats& tagStats = memoryTracking.tags[static_cast<uint32>(tag)];
+		size_t liveBytes = __atomic_add_fetch(&tagStats.liveBytes, size, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&tagStats.liveCount, 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&tagStats.totalCount, 1, __ATOMIC_RELAXED);
+
+		size_t peakBytes = __atomic_load_n(&tagStats.peakBytes, __ATOMIC_RELAXED);
+		while (liveBytes > peakBytes && !__atomic_compare_exchange_n(&tagStats.peakBytes, &peakBytes, liveBytes, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		{
+		}
+
+		MemorySiteStats& siteStats = memoryTracking.sites[header->siteIdx];
+		__atomic_add_fetch(&siteStats.liveBytes, size, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&siteStats.liveCount, 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&siteStats.totalCount, 1, __ATOMIC_RELAXED);
+
+		return memory + sizeof(MemoryTrackingHeader);
+	}
+
+	void MemoryDeallocate(void* ptr, size_t size)
+	{
+		if (!ptr)
+		{
+			return;
+		}
+
+		uint8* memory = static_cast<uint8*>(ptr) - sizeof(MemoryTrackingHeader);
+		MemoryTrackingHeader* header = reinterpret_cast<MemoryTrackingHeader*>(memory);
+
+		MemoryTagStats& tagStats = memoryTracking.tags[static_cast<uint32>(header->tag)];
+		__atomic_sub_fetch(&tagStats.liveBytes, size, __ATOMIC_RELAXED);
+		__atomic_sub_fetch(&tagStats.liveCount, 1, __ATOMIC_RELAXED);
+
+		MemorySiteStats& siteStats = memoryTracking.sites[header->siteIdx];
+		__atomic_sub_fetch(&siteStats.liveBytes, size, __ATOMIC_RELAXED);
+		__atomic_sub_fetch(&siteStats.liveCount, 1, __ATOMIC_RELAXED);
+
+		DeallocateUntracked(memory, size + sizeof(MemoryTrackingHeader));
+	}
+
+	MemoryTagStats GetMemoryTagStats(MemoryTag tag)
+	{
+		MemoryTagStats& tagStats = memoryTracking.tags[static_cast<uint32>(tag)];
+
+		MemoryTagStats result = {};
+		result.liveBytes = __atomic_load_n(&tagStats.liveBytes, __ATOMIC_RELAXED);
+		result.liveCount = __atomic_load_n(&tagStats.liveCount, __ATOMIC_RELAXED);
+		result.peakBytes = __atomic_load_n(&tagStats.peakBytes, __ATOMIC_RELAXED);
+		result.totalCount = __atomic_load_n(&tagStats.totalCount, __ATOMIC_RELAXED);
+
+		return result;
+	}
+
+	void MemoryReport(StringBuffer& buffer, uint32 maxSiteCount)
+	{
+		constexpr uint32 TagCount = static_cast<uint32>(MemoryTag::Count);
+		constexpr uint32 MaxReportedSites = 64;
+
+		MemoryTagStats tagStats[TagCount];
+		uint32 tagOrder[TagCount];
+
+		// Insertion sorts, there are few tags and only the largest sites are kept
+		for (uint32 tagIdx = 0; tagIdx < TagCount; ++tagIdx)
+		{
+			tagStats[tagIdx] = GetMemoryTagStats(static_cast<MemoryTag>(tagIdx));
+
+			uint32 orderIdx = tagIdx;
+			for (; orderIdx > 0 && tagStats[tagOrder[orderIdx - 1]].liveBytes < tagStats[tagIdx].liveBytes; --orderIdx)
+			{
+				tagOrder[orderIdx] = tagOrder[orderIdx - 1];
+			}
+
+			tagOrder[orderIdx] = tagIdx;
+		}
+
+		buffer.Appendf("%-10s %14s %10s %14s %10s\n", "Tag", "Live bytes", "Live", "Peak bytes", "Total");
+		for (uint32 orderIdx = 0; orderIdx < TagCount; ++orderIdx)
+		{
+			const MemoryTagStats& stats = tagStats[tagOrder[orderIdx]];
+			if (stats.totalCount > 0)
+			{
+				buffer.Appendf("%-10s %14zu %10zu %14zu %10zu\n", GetMemoryTagName(static_cast<MemoryTag>(tagOrder[orderIdx])),
+					stats.liveBytes, stats.liveCount, stats.peakBytes, stats.totalCount);
+			}
+		}
+
+		maxSiteCount = BK_MIN(maxSiteCount, MaxReportedSites);
+
+		uint32 siteOrder[MaxReportedSites];
+		size_t siteBytes[MaxReportedSites];
+		uint32 siteCount = 0;
+
+		for (uint32 siteIdx = 0; siteIdx < MemorySiteCapacity; ++siteIdx)
+		{
+			size_t liveBytes = __atomic_load_n(&memoryTracking.sites[siteIdx].liveBytes, __ATOMIC_RELAXED);
+			if (liveBytes == 0 || (siteCount == maxSiteCount && siteBytes[siteCount - 1] >= liveBytes))
+			{
+				continue;
+			}
+
+			uint32 orderIdx = BK_MIN(siteCount, maxSiteCount - 1);
+			for (; orderIdx > 0 && siteBytes[orderIdx - 1] < liveBytes; --orderIdx)
+			{
+				siteOrder[orderIdx] = siteOrder[orderIdx - 1];
+				siteBytes[orderIdx] = siteBytes[orderIdx - 1];
+			}
+
+			siteOrder[orderIdx] = siteIdx;
+			siteBytes[orderIdx] = liveBytes;
+			siteCount = BK_MIN(siteCount + 1, maxSiteCount);
+		}
+
+		if (siteCount > 0)
+		{
+			buffer.Appendf("\n%14s %10s  %s\n", "Live bytes", "Live", "Site");
+		}
+
+		for (uint32 orderIdx = 0; orderIdx < siteCount; ++orderIdx)
+		{
+			const MemorySiteStats& stats = memoryTracking.sites[siteOrder[orderIdx]];
+			size_t liveCount = __atomic_load_n(&stats.liveCount, __ATOMIC_RELAXED);
+
+			if (siteOrder[orderIdx] == 0)
+			{
+				buffer.Appendf("%14zu %10zu  (sites past the table capacity)\n", siteBytes[orderIdx], liveCount);
+			}
+			else
+			{
+				buffer.Appendf("%14zu %10zu  %s:%u [%s]\n", siteBytes[orderIdx], liveCount, stats.file, stats.line,
+					GetMemoryTagName(stats.tag));
+			}
+		}
+	}
+#else
+	void* MemoryAllocate(size_t size, MemoryTag tag, MemorySite site)
+	{
+		return AllocateUntracked(size);
+	}
+
+	void MemoryDeallocate(void* ptr, size_t size)
+	{
+		DeallocateUntracked(ptr, size);
+	}
+
+	MemoryTagStats GetMemoryTagStats(MemoryTag tag)
+	{
+		return {};
+	}
+
+	void MemoryReport(StringBuffer& buffer, uint32 maxSiteCount)
+	{
+		buffer.Appendf("Memory tracking is disabled, build with BK_MEMORY_TRACKING to enable it\n");
+	}
+#endif
+
+	const char* GetMemoryTagName(MemoryTag tag)
+	{
+		switch (tag)
+		{
+			case MemoryTag::General: return "General";
+			case MemoryTag::Arena: return "Arena";
+			case MemoryTag::Gpu: return "Gpu";
+			case MemoryTag::Jobs: return "Jobs";
+			case MemoryTag::Json: return "Json";
+			case MemoryTag::Sandbox: return "Sandbox";
+			case MemoryTag::Count: break;
+		}
+
+		return "Unknown";
+	}
 
 	void* MemoryCopy(void* dst, const void* src, size_t size)
 	{
@@ -40,6 +846,69 @@ namespace Bk
 		return memset(ptr, 0, size);
 	}
 
+	static uint64 MemoryHashRound(uint64 hash, uint64 value)
+	{
+		hash += value * 0xC2B2AE3D27D4EB4Full;
+		hash = (hash << 31) | (hash >> 33);
+		return hash * 0x9E3779B185EBCA87ull;
+	}
+
+	static uint64 MemoryHashRead(const uint8* data)
+	{
+		uint64 value;
+		memcpy(&value, data, sizeof(value));
+
+		return value;
+	}
+
+	uint64 MemoryHash(const void* data, size_t size, uint64 seed)
+	{
+		const uint8* bytes = static_cast<const uint8*>(data);
+		const uint8* end = bytes + size;
+
+		uint64 hash = seed + 0x27D4EB2F165667C5ull + size;
+
+		if (size >= 32)
+		{
+			// Four independent lanes so the multiplies can overlap
+			uint64 lanes[4] = { seed + 0x60EA27EEADC0B5D6ull, seed + 0xC2B2AE3D27D4EB4Full, seed, seed - 0x9E3779B185EBCA87ull };
+
+			for (; bytes + 32 <= end; bytes += 32)
+			{
+				lanes[0] = MemoryHashRound(lanes[0], MemoryHashRead(bytes + 0));
+				lanes[1] = MemoryHashRound(lanes[1], MemoryHashRead(bytes + 8));
+				lanes[2] = MemoryHashRound(lanes[2], MemoryHashRead(bytes + 16));
+				lanes[3] = MemoryHashRound(lanes[3], MemoryHashRead(bytes + 24));
+			}
+
+			for (uint64 lane : lanes)
+			{
+				hash = (hash ^ MemoryHashRound(0, lane)) * 0x9E3779B185EBCA87ull + 0x85EBCA77C2B2AE63ull;
+			}
+		}
+
+		for (; bytes + 8 <= end; bytes += 8)
+		{
+			hash ^= MemoryHashRound(0, MemoryHashRead(bytes));
+			hash = ((hash << 27) | (hash >> 37)) * 0x9E3779B185EBCA87ull + 0x85EBCA77C2B2AE63ull;
+		}
+
+		for (; bytes < end; bytes += 1)
+		{
+			hash ^= *bytes * 0x27D4EB2F165667C5ull;
+			hash = ((hash << 11) | (hash >> 53)) * 0x9E3779B185EBCA87ull;
+		}
+
+		// Final avalanche
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
+		hash *= 0xC4CEB9FE1A85EC53ull;
+		hash ^= hash >> 33;
+
+		return hash;
+	}
+
 	uint32 CountLeadingZeros(uint64 value)
 	{
 		return value ? static_cast<uint32>(__builtin_clzll(value)) : 64;
@@ -9,18 +9,60 @@
 
 namespace Bk
 {
+	struct StringBuffer;
+
 	template<typename T>
 	constexpr T AlignUp(T value, uintptr_t alignment);
 
-	void* MemoryAllocate(size_t size);
+	// Subsystem an allocation is attributed to when built with BK_MEMORY_TRACKING
+	enum class MemoryTag : uint8
+	{
+		General,
+		Arena, // Blocks of arenas that weren't given a tag of their own
+		Gpu,
+		Jobs,
+		Json,
+		Sandbox,
+		Count,
+	};
+
+	// Where an allocation was made from. Taken as a defaulted last argument, so it's filled in at the call site
+	struct MemorySite
+	{
+		static constexpr MemorySite Current(const char* file = __builtin_FILE(), uint32 line = __builtin_LINE());
+
+		const char* file;
+		uint32 line;
+	};
+
+	struct MemoryTagStats
+	{
+		size_t liveBytes;
+		size_t liveCount;
+		size_t peakBytes;
+		size_t totalCount;
+	};
+
+	// Forwards to malloc unless built with BK_SIZE_CLASS_ALLOCATOR, which serves small sizes from thread-local slabs
+	// and maps large ones directly. Either way size must match the one the memory was allocated with
+	void* MemoryAllocate(size_t size, MemoryTag tag = MemoryTag::General, MemorySite site = MemorySite::Current());
 	void MemoryDeallocate(void* ptr, size_t size);
 
+	// Only counted when built with BK_MEMORY_TRACKING, which puts a small header in front of every allocation and
+	// keeps per tag and per call site totals with atomics. The report lists tags and the call sites holding the most
+	// live memory, largest first, so anything left at shutdown is a leak
+	const char* GetMemoryTagName(MemoryTag tag);
+	MemoryTagStats GetMemoryTagStats(MemoryTag tag);
+	void MemoryReport(StringBuffer& buffer, uint32 maxSiteCount = 16);
+
 	void* MemoryCopy(void* dst, const void* src, size_t size);
 	void* MemoryMove(void* dst, const void* src, size_t size);
 	int32 MemoryCompare(const void* a, const void* b, size_t size);
 	void* MemorySet(void* ptr, int32 value, size_t size);
 	void* MemoryZero(void* ptr, size_t size);
 
+	uint64 MemoryHash(const void* data, size_t size, uint64 seed = 0);
+
 	uint32 CountLeadingZeros(uint64 value);
 	uint32 CountTrailingZeros(uint64 value);
 
@@ -33,6 +75,11 @@ namespace Bk
 
 namespace Bk
 {
+	constexpr MemorySite MemorySite::Current(const char* file, uint32 line)
+	{
+		return {file, line};
+	}
+
 	template<typename T>
 	constexpr T AlignUp(T value, uintptr_t alignment)
 	{
@@ -3,21 +3,47 @@
 #include "BkArena.h"
 #include "BkCore.h"
 #include "BkMemory.h"
+#include "BkSpan.h"
 
 namespace Bk
 {
+	// Visits the live items of a pool in index order, skipping 32 free slots at a time through the alive bitset
+	template<typename Pool, typename Type>
+	struct TPoolIterator
+	{
+		Type& operator*() const;
+		TPoolIterator& operator++();
+		bool operator!=(const TPoolIterator& other) const;
+
+		void SkipEmptyWords();
+
+		Pool* pool;
+		size_t wordIdx;
+		size_t wordCount;
+		uint32 word; // Live items of the current word that haven't been visited yet
+	};
+
 	template<typename Type>
 	struct TPool
 	{
 		static_assert(sizeof(Type) >= sizeof(uintptr_t), "Pool type must be at least the size of a pointer");
 
-		void Initialize(Arena* arena, uint16 size);
+		// Retiring takes a slot out of use once its generation would wrap, so no stale handle can ever match it again
+		void Initialize(Arena* arena, uint16 size, bool retireWrappedSlots = false);
 
 		Type* AllocateItem(uint32* handle = nullptr);
-		void FreeItem(uint32 handle);
+		void FreeItem(uint32 handle); // Stale handles are counted and ignored
 
 		uint32 GetHandle(Type* item);
 		Type* GetItem(uint32 handle);
+		Type* TryGetItem(uint32 handle); // Null for stale or freed handles
+
+		// Range-for over live items, the item being visited may be freed
+		TPoolIterator<TPool, Type> begin();
+		TPoolIterator<TPool, Type> end();
+
+		uint32 GetAliveWord(size_t wordIdx) const;
+		Type& GetItemAt(size_t index);
 
 		Type* items;
 		uint16* generations;
@@ -25,16 +51,228 @@ namespace Bk
 		uintptr_t nextFree;
 		size_t capacity;
 		size_t count;
+		size_t staleAccessCount; // Stale handles passed to GetItem, TryGetItem or FreeItem
+		size_t retiredCount;
+		bool retireWrappedSlots;
+	};
+
+	// TPool that grows a page at a time, up to maxCount items, without ever moving them. Handles hold IndexBits of
+	// index with the generation above it, e.g. TPagedPool<Type, uint64, 32> for 32 bit generations
+	template<typename Type, typename HandleType = uint32, uint32 IndexBits = 16, uint32 PageSize = 256>
+	struct TPagedPool
+	{
+		static_assert(sizeof(Type) >= sizeof(uint32), "Pool type must be at least the size of a uint32");
+		static_assert(IndexBits <= 32 && IndexBits < sizeof(HandleType) * 8, "Handle needs room for a generation");
+		static_assert(PageSize >= 32 && (PageSize & (PageSize - 1)) == 0, "Page size must be a power of two of at least 32");
+
+		static constexpr HandleType IndexMask = (HandleType(1) << IndexBits) - 1;
+		static constexpr HandleType GenerationMask = HandleType(~HandleType(0)) >> IndexBits;
+
+		struct Page
+		{
+			Type items[PageSize];
+			HandleType generations[PageSize];
+			uint32 alive[PageSize / 32];
+		};
+
+		// Pages and the page table come from the arena, the table doubles as it fills. Retiring works like TPool's
+		void Initialize(Arena* arena, size_t maxCount = IndexMask, bool retireWrappedSlots = false);
+
+		Type* AllocateItem(HandleType* handle = nullptr);
+		void FreeItem(HandleType handle); // Stale handles are counted and ignored
+
+		HandleType GetHandle(Type* item); // Searches the pages for the item
+		Type* GetItem(HandleType handle);
+		Type* TryGetItem(HandleType handle); // Null for stale or freed handles
+
+		TPoolIterator<TPagedPool, Type> begin();
+		TPoolIterator<TPagedPool, Type> end();
+
+		uint32 GetAliveWord(size_t wordIdx) const;
+		Type& GetItemAt(size_t index);
+
+		Arena* arena;
+		Page** pages;
+		size_t pageCount;
+		size_t pageCapacity;
+		size_t maxCount;
+		size_t count;
+		size_t nextFree; // Index + 1 of the first free item, 0 when there is none
+		size_t staleAccessCount; // Stale handles passed to GetItem, TryGetItem or FreeItem
+		size_t retiredCount;
+		bool retireWrappedSlots;
+	};
+
+	// Sparse set, handles index a sparse array that points into a packed item array. Freeing moves the last item
+	// into the gap, so items stay contiguous for per-frame loops but pointers don't outlive the next free
+	template<typename Type>
+	struct TDensePool
+	{
+		void Initialize(Arena* arena, uint16 size);
+
+		Type* AllocateItem(uint32* handle = nullptr);
+		void FreeItem(uint32 handle);
+
+		Type* GetItem(uint32 handle);
+		uint32 GetHandle(size_t denseIndex) const;
+
+		TSpan<Type> GetItems() const;
+
+		Type* items;
+		uint32* denseToSparse;
+		uint32* sparseToDense; // Next free sparse index + 1 while the slot is free
+		uint16* generations;
+		uint32 nextFree; // Sparse index + 1 of the first free slot, 0 when there is none
+		size_t capacity;
+		size_t count; // Live items, all packed at the start of items
+		size_t sparseCount;
+	};
+
+	template<size_t FieldIdx, typename First, typename... Rest>
+	struct TSoaField
+	{
+		using Type = typename TSoaField<FieldIdx - 1, Rest...>::Type;
+	};
+
+	template<typename First, typename... Rest>
+	struct TSoaField<0, First, Rest...>
+	{
+		using Type = First;
+	};
+
+	// TDensePool with every field in its own array, e.g. TSoaPool<float, float, float, uint32> for positions and
+	// flags. Live items are packed at the start of each array, so GetField spans can be looped over directly
+	template<typename... Fields>
+	struct TSoaPool
+	{
+		static constexpr size_t FieldCount = sizeof...(Fields);
+		static constexpr size_t FieldSizes[FieldCount] = {sizeof(Fields)...};
+		static constexpr size_t FieldAlignment = 64;
+
+		template<size_t FieldIdx>
+		using FieldType = typename TSoaField<FieldIdx, Fields...>::Type;
+
+		void Initialize(Arena* arena, uint16 size);
+
+		uint32 AllocateItem(); // Handle of the new item with its fields uninitialized, 0 when full
+		void FreeItem(uint32 handle);
+
+		template<size_t FieldIdx>
+		FieldType<FieldIdx>& Get(uint32 handle);
+
+		// Live items only, in dense order
+		template<size_t FieldIdx>
+		TSpan<FieldType<FieldIdx>> GetField();
+
+		bool IsValid(uint32 handle) const;
+		size_t GetDenseIndex(uint32 handle) const;
+		uint32 GetHandle(size_t denseIndex) const;
+
+		uint8* fields[FieldCount];
+		uint32* denseToSparse;
+		uint32* sparseToDense; // Next free sparse index + 1 while the slot is free
+		uint16* generations;
+		uint32 nextFree;
+		size_t capacity;
+		size_t count;
+		size_t sparseCount;
 	};
+
+	constexpr uint32 PoolCacheCount = 16;
+	constexpr uint32 PoolCacheSize = 32;
+
+	// Small stash of free indices, shared by the threads that map to it but almost never contended
+	struct alignas(64) PoolCache
+	{
+		uint32 lock;
+		uint32 count;
+		uint32 indices[PoolCacheSize];
+	};
+
+	// TPool that can be used from several threads at once, with the same handles. Free indices sit in per-thread
+	// caches first and overflow into a lock-free list whose head is tagged against ABA. Frees bump the generation
+	// with a CAS, so GetItem can validate handles without locking, and a double free only succeeds once
+	template<typename Type>
+	struct TConcurrentPool
+	{
+		void Initialize(Arena* arena, uint16 size);
+
+		Type* AllocateItem(uint32* handle = nullptr);
+		void FreeItem(uint32 handle);
+
+		uint32 GetHandle(Type* item);
+		Type* GetItem(uint32 handle); // Null for handles that are stale or were never allocated
+
+		Type* items;
+		uint16* generations;
+		uint32* alive;
+		uint32* nextFree; // Index + 1 of the next free item in the list, 0 ends it
+		PoolCache* caches;
+		uint64 freeHead; // Tag in the high half, index + 1 of the first free item in the low half
+		size_t capacity;
+		size_t count;
+
+		uint32 PopFreeIndex();
+		void PushFreeIndices(const uint32* indices, uint32 indexCount);
+		uint32 StealCachedIndex();
+	};
+
+	// Threads are spread over the caches in the order they first use a pool
+	inline uint32 GetPoolThreadSlot()
+	{
+		static uint32 nextSlot = 0;
+		static thread_local uint32 slot = __atomic_fetch_add(&nextSlot, 1u, __ATOMIC_RELAXED);
+
+		return slot;
+	}
 }
 
 namespace Bk
 {
+	template<typename Pool, typename Type>
+	Type& TPoolIterator<Pool, Type>::operator*() const
+	{
+		return pool->GetItemAt(wordIdx * 32 + CountTrailingZeros(word));
+	}
+
+	template<typename Pool, typename Type>
+	TPoolIterator<Pool, Type>& TPoolIterator<Pool, Type>::operator++()
+	{
+		word &= word - 1;
+		SkipEmptyWords();
+
+		return *this;
+	}
+
+	template<typename Pool, typename Type>
+	bool TPoolIterator<Pool, Type>::operator!=(const TPoolIterator& other) const
+	{
+		return wordIdx != other.wordIdx || word != other.word;
+	}
+
+	template<typename Pool, typename Type>
+	void TPoolIterator<Pool, Type>::SkipEmptyWords()
+	{
+		while (word == 0 && wordIdx + 1 < wordCount)
+		{
+			wordIdx += 1;
+			word = pool->GetAliveWord(wordIdx);
+		}
+
+		if (word == 0)
+		{
+			wordIdx = wordCount;
+		}
+	}
+
 	template<typename Type>
-	void TPool<Type>::Initialize(Arena* arena, uint16 size)
+	void TPool<Type>::Initialize(Arena* arena, uint16 size, bool retireWrapped)
 	{
 		capacity = size;
 		count = 0;
+		staleAccessCount = 0;
+		retiredCount = 0;
+		retireWrappedSlots = retireWrapped;
 
 		items = arena->Push<Type>(capacity);
 		generations = arena->PushZeroed<uint16>(capacity);
@@ -88,12 +326,27 @@ namespace Bk
 		size_t index = handle & 0xFFFF;
 		BK_ASSERT(index < count);
 
+		// Generation 0 marks free and retired slots, it never belongs to a valid handle
 		uint16 generation = handle >> 16;
-		BK_ASSERT(generation == generations[index]);
+		if (generation == 0 || generation != generations[index])
+		{
+			staleAccessCount += 1;
+			BK_ASSERTF(false, "Stale handle or double free");
+			return;
+		}
 
-		generations[index] += 1;
 		BitsetUnset(alive, index);
 
+		if (generation == UINT16_MAX && retireWrappedSlots)
+		{
+			// Handles with generation 0 are always rejected, and the slot stays off the free list
+			generations[index] = 0;
+			retiredCount += 1;
+			return;
+		}
+
+		generations[index] += 1;
+
 		Type* item = items + index;
 		*reinterpret_cast<uintptr_t*>(item) = nextFree;
 		nextFree = reinterpret_cast<uintptr_t>(item);
@@ -104,6 +357,7 @@ namespace Bk
 	{
 		size_t index = item - items;
 		BK_ASSERT(index < count);
+		BK_ASSERTF(BitsetIsSet(alive, index), "Item was freed");
 
 		uint16 generation = generations[index];
 
@@ -117,8 +371,709 @@ namespace Bk
 		BK_ASSERT(index < count);
 
 		uint16 generation = handle >> 16;
-		BK_ASSERT(generation == generations[index]);
+		if (generation == 0 || generation != generations[index])
+		{
+			staleAccessCount += 1;
+			BK_ASSERTF(false, "Stale handle");
+		}
+
+		return items + index;
+	}
+
+	template<typename Type>
+	Type* TPool<Type>::TryGetItem(uint32 handle)
+	{
+		// Slots past count, retired slots and wrapped free slots have generation 0, which no valid handle carries
+		size_t index = handle & 0xFFFF;
+		if (index < count && (handle >> 16) != 0 && generations[index] == (handle >> 16))
+		{
+			return items + index;
+		}
+
+		// Zero is the null handle, not a stale one
+		staleAccessCount += handle != 0;
+		return nullptr;
+	}
+
+	template<typename Type>
+	TPoolIterator<TPool<Type>, Type> TPool<Type>::begin()
+	{
+		size_t wordCount = (count + 31) / 32;
+
+		TPoolIterator<TPool, Type> iterator = {this, 0, wordCount, wordCount > 0 ? alive[0] : 0};
+		iterator.SkipEmptyWords();
+
+		return iterator;
+	}
+
+	template<typename Type>
+	TPoolIterator<TPool<Type>, Type> TPool<Type>::end()
+	{
+		size_t wordCount = (count + 31) / 32;
+		return {this, wordCount, wordCount, 0};
+	}
+
+	template<typename Type>
+	uint32 TPool<Type>::GetAliveWord(size_t wordIdx) const
+	{
+		return alive[wordIdx];
+	}
+
+	template<typename Type>
+	Type& TPool<Type>::GetItemAt(size_t index)
+	{
+		return items[index];
+	}
+
+	template<typename Type, typename HandleType, uint32 IndexBits, uint32 PageSize>
+	void TPagedPool<Type, HandleType, IndexBits, PageSize>::Initialize(Arena* poolArena, size_t poolMaxCount, bool retireWrapped)
+	{
+		arena = poolArena;
+		pages = nullptr;
+		pageCount = 0;
+		pageCapacity = 0;
+		maxCount = BK_MIN(poolMaxCount, size_t(IndexMask));
+		count = 0;
+		nextFree = 0;
+		staleAccessCount = 0;
+		retiredCount = 0;
+		retireWrappedSlots = retireWrapped;
+	}
+
+	template<typename Type, typename HandleType, uint32 IndexBits, uint32 PageSize>
+	Type* TPagedPool<Type, HandleType, IndexBits, PageSize>::AllocateItem(HandleType* handle)
+	{
+		size_t index;
+
+		if (nextFree)
+		{
+			index = nextFree - 1;
+
+			uint32 next;
+			MemoryCopy(&next, &pages[index / PageSize]->items[index % PageSize], sizeof(next));
+			nextFree = next;
+		}
+		else if (count < maxCount)
+		{
+			index = count;
+
+			if (index / PageSize == pageCount)
+			{
+				if (pageCount == pageCapacity)
+				{
+					// The old table stays behind in the arena, only the pages have to be stable
+					size_t newPageCapacity = pageCapacity > 0 ? pageCapacity * 2 : 4;
+					Page** newPages = arena->Push<Page*>(newPageCapacity);
+					if (pageCount > 0)
+					{
+						MemoryCopy(newPages, pages, sizeof(Page*) * pageCount);
+					}
+
+					pages = newPages;
+					pageCapacity = newPageCapacity;
+				}
+
+				pages[pageCount] = arena->PushZeroed<Page>();
+				pageCount += 1;
+			}
+
+			count += 1;
+		}
+		else
+		{
+			return nullptr;
+		}
+
+		Page* page = pages[index / PageSize];
+		size_t slot = index % PageSize;
+
+		HandleType& generation = page->generations[slot];
+		if (generation == 0)
+		{
+			generation = 1;
+		}
+
+		BitsetSet(page->alive, slot);
+
+		if (handle)
+		{
+			*handle = (generation << IndexBits) | static_cast<HandleType>(index);
+		}
+
+		return &page->items[slot];
+	}
+
+	template<typename Type, typename HandleType, uint32 IndexBits, uint32 PageSize>
+	void TPagedPool<Type, HandleType, IndexBits, PageSize>::FreeItem(HandleType handle)
+	{
+		size_t index = static_cast<size_t>(handle & IndexMask);
+		BK_ASSERT(index < count);
+
+		Page* page = pages[index / PageSize];
+		size_t slot = index % PageSize;
+
+		// Generation 0 marks free and retired slots, it never belongs to a valid handle
+		HandleType& generation = page->generations[slot];
+		if ((handle >> IndexBits) == 0 || (handle >> IndexBits) != generation)
+		{
+			staleAccessCount += 1;
+			BK_ASSERTF(false, "Stale handle or double free");
+			return;
+		}
+
+		BitsetUnset(page->alive, slot);
+
+		if (generation == GenerationMask && retireWrappedSlots)
+		{
+			generation = 0;
+			retiredCount += 1;
+			return;
+		}
+
+		// Wraps to 0, which AllocateItem skips
+		generation = (generation + 1) & GenerationMask;
+
+		uint32 next = static_cast<uint32>(nextFree);
+		MemoryCopy(&page->items[slot], &next, sizeof(next));
+		nextFree = index + 1;
+	}
+
+	template<typename Type, typename HandleType, uint32 IndexBits, uint32 PageSize>
+	HandleType TPagedPool<Type, HandleType, IndexBits, PageSize>::GetHandle(Type* item)
+	{
+		uintptr_t address = reinterpret_cast<uintptr_t>(item);
+
+		for (size_t pageIdx = 0; pageIdx < pageCount; ++pageIdx)
+		{
+			uintptr_t pageAddress = reinterpret_cast<uintptr_t>(pages[pageIdx]->items);
+			if (address >= pageAddress && address < pageAddress + sizeof(Type) * PageSize)
+			{
+				size_t slot = (address - pageAddress) / sizeof(Type);
+				BK_ASSERTF(BitsetIsSet(pages[pageIdx]->alive, slot), "Item was freed");
+
+				return (pages[pageIdx]->generations[slot] << IndexBits) | static_cast<HandleType>(pageIdx * PageSize + slot);
+			}
+		}
+
+		BK_ASSERTF(false, "Item isn't from this pool");
+		return 0;
+	}
+
+	template<typename Type, typename HandleType, uint32 IndexBits, uint32 PageSize>
+	Type* TPagedPool<Type, HandleType, IndexBits, PageSize>::GetItem(HandleType handle)
+	{
+		size_t index = static_cast<size_t>(handle & IndexMask);
+		BK_ASSERT(index < count);
+
+		Page* page = pages[index / PageSize];
+		size_t slot = index % PageSize;
+
+		if ((handle >> IndexBits) == 0 || (handle >> IndexBits) != page->generations[slot])
+		{
+			staleAccessCount += 1;
+			BK_ASSERTF(false, "Stale handle");
+		}
+
+		return &page->items[slot];
+	}
+
+	template<typename Type, typename HandleType, uint32 IndexBits, uint32 PageSize>
+	Type* TPagedPool<Type, HandleType, IndexBits, PageSize>::TryGetItem(HandleType handle)
+	{
+		size_t index = static_cast<size_t>(handle & IndexMask);
+		if (index < count && (handle >> IndexBits) != 0)
+		{
+			Page* page = pages[index / PageSize];
+			if ((handle >> IndexBits) == page->generations[index % PageSize])
+			{
+				return &page->items[index % PageSize];
+			}
+		}
+
+		// Zero is the null handle, not a stale one
+		staleAccessCount += handle != 0;
+		return nullptr;
+	}
+
+	template<typename Type, typename HandleType, uint32 IndexBits, uint32 PageSize>
+	TPoolIterator<TPagedPool<Type, HandleType, IndexBits, PageSize>, Type> TPagedPool<Type, HandleType, IndexBits, PageSize>::begin()
+	{
+		size_t wordCount = (count + 31) / 32;
+
+		TPoolIterator<TPagedPool, Type> iterator = {this, 0, wordCount, wordCount > 0 ? GetAliveWord(0) : 0};
+		iterator.SkipEmptyWords();
+
+		return iterator;
+	}
+
+	template<typename Type, typename HandleType, uint32 IndexBits, uint32 PageSize>
+	TPoolIterator<TPagedPool<Type, HandleType, IndexBits, PageSize>, Type> TPagedPool<Type, HandleType, IndexBits, PageSize>::end()
+	{
+		size_t wordCount = (count + 31) / 32;
+		return {this, wordCount, wordCount, 0};
+	}
+
+	template<typename Type, typename HandleType, uint32 IndexBits, uint32 PageSize>
+	uint32 TPagedPool<Type, HandleType, IndexBits, PageSize>::GetAliveWord(size_t wordIdx) const
+	{
+		constexpr size_t PageWordCount = PageSize / 32;
+		return pages[wordIdx / PageWordCount]->alive[wordIdx % PageWordCount];
+	}
+
+	template<typename Type, typename HandleType, uint32 IndexBits, uint32 PageSize>
+	Type& TPagedPool<Type, HandleType, IndexBits, PageSize>::GetItemAt(size_t index)
+	{
+		return pages[index / PageSize]->items[index % PageSize];
+	}
+
+	template<typename Type>
+	void TDensePool<Type>::Initialize(Arena* arena, uint16 size)
+	{
+		capacity = size;
+		count = 0;
+		sparseCount = 0;
+		nextFree = 0;
+
+		items = arena->Push<Type>(capacity);
+		denseToSparse = arena->Push<uint32>(capacity);
+		sparseToDense = arena->Push<uint32>(capacity);
+		generations = arena->PushZeroed<uint16>(capacity);
+	}
+
+	template<typename Type>
+	Type* TDensePool<Type>::AllocateItem(uint32* handle)
+	{
+		uint32 index;
+
+		if (nextFree)
+		{
+			index = nextFree - 1;
+			nextFree = sparseToDense[index];
+		}
+		else if (sparseCount < capacity)
+		{
+			index = static_cast<uint32>(sparseCount);
+			sparseCount += 1;
+		}
+		else
+		{
+			return nullptr;
+		}
+
+		size_t denseIndex = count;
+		count += 1;
+
+		sparseToDense[index] = static_cast<uint32>(denseIndex);
+		denseToSparse[denseIndex] = index;
+
+		uint16& generation = generations[index];
+		if (generation == 0)
+		{
+			generation = 1;
+		}
+
+		if (handle)
+		{
+			*handle = (static_cast<uint32>(generation) << 16) | index;
+		}
+
+		return items + denseIndex;
+	}
+
+	template<typename Type>
+	void TDensePool<Type>::FreeItem(uint32 handle)
+	{
+		uint32 index = handle & 0xFFFF;
+		BK_ASSERT(index < sparseCount);
+
+		uint16 generation = handle >> 16;
+		BK_ASSERT(generation != 0 && generation == generations[index]);
+
+		generations[index] += 1;
+
+		// Last item fills the gap
+		size_t denseIndex = sparseToDense[index];
+		size_t lastIndex = count - 1;
+
+		if (denseIndex != lastIndex)
+		{
+			MemoryCopy(items + denseIndex, items + lastIndex, sizeof(Type));
+
+			uint32 movedIndex = denseToSparse[lastIndex];
+			denseToSparse[denseIndex] = movedIndex;
+			sparseToDense[movedIndex] = static_cast<uint32>(denseIndex);
+		}
+
+		count -= 1;
+
+		sparseToDense[index] = nextFree;
+		nextFree = index + 1;
+	}
+
+	template<typename Type>
+	Type* TDensePool<Type>::GetItem(uint32 handle)
+	{
+		uint32 index = handle & 0xFFFF;
+		BK_ASSERT(index < sparseCount);
+
+		uint16 generation = handle >> 16;
+		BK_ASSERT(generation != 0 && generation == generations[index]);
+
+		return items + sparseToDense[index];
+	}
+
+	template<typename Type>
+	uint32 TDensePool<Type>::GetHandle(size_t denseIndex) const
+	{
+		BK_ASSERT(denseIndex < count);
+
+		uint32 index = denseToSparse[denseIndex];
+		return (static_cast<uint32>(generations[index]) << 16) | index;
+	}
+
+	template<typename Type>
+	TSpan<Type> TDensePool<Type>::GetItems() const
+	{
+		return TSpan<Type>(items, count);
+	}
+
+	template<typename... Fields>
+	void TSoaPool<Fields...>::Initialize(Arena* arena, uint16 size)
+	{
+		capacity = size;
+		count = 0;
+		sparseCount = 0;
+		nextFree = 0;
+
+		constexpr size_t FieldAlignments[FieldCount] = {BK_MAX(alignof(Fields), FieldAlignment)...};
+		for (size_t fieldIdx = 0; fieldIdx < FieldCount; ++fieldIdx)
+		{
+			fields[fieldIdx] = arena->Push(FieldSizes[fieldIdx] * capacity, FieldAlignments[fieldIdx]);
+		}
+
+		denseToSparse = arena->Push<uint32>(capacity);
+		sparseToDense = arena->Push<uint32>(capacity);
+		generations = arena->PushZeroed<uint16>(capacity);
+	}
+
+	template<typename... Fields>
+	uint32 TSoaPool<Fields...>::AllocateItem()
+	{
+		uint32 index;
+
+		if (nextFree)
+		{
+			index = nextFree - 1;
+			nextFree = sparseToDense[index];
+		}
+		else if (sparseCount < capacity)
+		{
+			index = static_cast<uint32>(sparseCount);
+			sparseCount += 1;
+		}
+		else
+		{
+			return 0;
+		}
+
+		size_t denseIndex = count;
+		count += 1;
+
+		sparseToDense[index] = static_cast<uint32>(denseIndex);
+		denseToSparse[denseIndex] = index;
+
+		uint16& generation = generations[index];
+		if (generation == 0)
+		{
+			generation = 1;
+		}
+
+		return (static_cast<uint32>(generation) << 16) | index;
+	}
+
+	template<typename... Fields>
+	void TSoaPool<Fields...>::FreeItem(uint32 handle)
+	{
+		uint32 index = handle & 0xFFFF;
+		BK_ASSERT(index < sparseCount);
+
+		uint16 generation = handle >> 16;
+		BK_ASSERT(generation != 0 && generation == generations[index]);
+
+		generations[index] += 1;
+
+		// Last item fills the gap in every field
+		size_t denseIndex = sparseToDense[index];
+		size_t lastIndex = count - 1;
+
+		if (denseIndex != lastIndex)
+		{
+			for (size_t fieldIdx = 0; fieldIdx < FieldCount; ++fieldIdx)
+			{
+				size_t fieldSize = FieldSizes[fieldIdx];
+				MemoryCopy(fields[fieldIdx] + denseIndex * fieldSize, fields[fieldIdx] + lastIndex * fieldSize, fieldSize);
+			}
+
+			uint32 movedIndex = denseToSparse[lastIndex];
+			denseToSparse[denseIndex] = movedIndex;
+			sparseToDense[movedIndex] = static_cast<uint32>(denseIndex);
+		}
+
+		count -= 1;
+
+		sparseToDense[index] = nextFree;
+		nextFree = index + 1;
+	}
+
+	template<typename... Fields>
+	template<size_t FieldIdx>
+	typename TSoaPool<Fields...>::template FieldType<FieldIdx>& TSoaPool<Fields...>::Get(uint32 handle)
+	{
+		return reinterpret_cast<FieldType<FieldIdx>*>(fields[FieldIdx])[GetDenseIndex(handle)];
+	}
+
+	template<typename... Fields>
+	template<size_t FieldIdx>
+	TSpan<typename TSoaPool<Fields...>::template FieldType<FieldIdx>> TSoaPool<Fields...>::GetField()
+	{
+		return TSpan<FieldType<FieldIdx>>(reinterpret_cast<FieldType<FieldIdx>*>(fields[FieldIdx]), count);
+	}
+
+	template<typename... Fields>
+	bool TSoaPool<Fields...>::IsValid(uint32 handle) const
+	{
+		uint32 index = handle & 0xFFFF;
+		return index < sparseCount && (handle >> 16) != 0 && generations[index] == (handle >> 16);
+	}
+
+	template<typename... Fields>
+	size_t TSoaPool<Fields...>::GetDenseIndex(uint32 handle) const
+	{
+		uint32 index = handle & 0xFFFF;
+		BK_ASSERT(index < sparseCount);
+
+		uint16 generation = handle >> 16;
+		BK_ASSERT(generation != 0 && generation == generations[index]);
+
+		return sparseToDense[index];
+	}
+
+	template<typename... Fields>
+	uint32 TSoaPool<Fields...>::GetHandle(size_t denseIndex) const
+	{
+		BK_ASSERT(denseIndex < count);
+
+		uint32 index = denseToSparse[denseIndex];
+		return (static_cast<uint32>(generations[index]) << 16) | index;
+	}
+
+	template<typename Type>
+	void TConcurrentPool<Type>::Initialize(Arena* arena, uint16 size)
+	{
+		capacity = size;
+		count = 0;
+
+		items = arena->Push<Type>(capacity);
+		generations = arena->PushZeroed<uint16>(capacity);
+		alive = arena->PushZeroed<uint32>((capacity + 31) / 32);
+		nextFree = arena->PushZeroed<uint32>(capacity);
+		caches = arena->PushZeroed<PoolCache>(PoolCacheCount);
+		freeHead = 0;
+	}
+
+	template<typename Type>
+	Type* TConcurrentPool<Type>::AllocateItem(uint32* handle)
+	{
+		uint32 index = UINT32_MAX;
+
+		PoolCache& cache = caches[GetPoolThreadSlot() % PoolCacheCount];
+		if (!__atomic_exchange_n(&cache.lock, 1u, __ATOMIC_ACQUIRE))
+		{
+			// Refill half the cache at once, so the shared list is touched once per batch
+			while (cache.count < PoolCacheSize / 2)
+			{
+				uint32 freeIndex = PopFreeIndex();
+				if (freeIndex == UINT32_MAX)
+				{
+					break;
+				}
+
+				cache.indices[cache.count++] = freeIndex;
+			}
+
+			if (cache.count > 0)
+			{
+				index = cache.indices[--cache.count];
+			}
+
+			__atomic_store_n(&cache.lock, 0u, __ATOMIC_RELEASE);
+		}
+		else
+		{
+			index = PopFreeIndex();
+		}
+
+		if (index == UINT32_MAX)
+		{
+			size_t used = __atomic_load_n(&count, __ATOMIC_RELAXED);
+			while (used < capacity && !__atomic_compare_exchange_n(&count, &used, used + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			{
+			}
+
+			if (used < capacity)
+			{
+				index = static_cast<uint32>(used);
+				__atomic_store_n(&generations[index], uint16(1), __ATOMIC_RELEASE);
+			}
+			else
+			{
+				// Full apart from whatever other threads have stashed away
+				index = StealCachedIndex();
+				if (index == UINT32_MAX)
+				{
+					return nullptr;
+				}
+			}
+		}
+
+		__atomic_fetch_or(&alive[index / 32], 1u << (index % 32), __ATOMIC_RELAXED);
+
+		if (handle)
+		{
+			*handle = (static_cast<uint32>(__atomic_load_n(&generations[index], __ATOMIC_RELAXED)) << 16) | index;
+		}
 
 		return items + index;
 	}
+
+	template<typename Type>
+	void TConcurrentPool<Type>::FreeItem(uint32 handle)
+	{
+		uint32 index = handle & 0xFFFF;
+		BK_ASSERT(index < __atomic_load_n(&count, __ATOMIC_RELAXED));
+
+		// Generation 0 is never handed out, so a zeroed handle can't match
+		uint16 generation = static_cast<uint16>(handle >> 16);
+		uint16 nextGeneration = static_cast<uint16>(generation + 1);
+		nextGeneration = nextGeneration != 0 ? nextGeneration : uint16(1);
+
+		if (!__atomic_compare_exchange_n(&generations[index], &generation, nextGeneration, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		{
+			BK_ASSERTF(false, "Stale handle or double free");
+			return;
+		}
+
+		__atomic_fetch_and(&alive[index / 32], ~(1u << (index % 32)), __ATOMIC_RELAXED);
+
+		PoolCache& cache = caches[GetPoolThreadSlot() % PoolCacheCount];
+		if (!__atomic_exchange_n(&cache.lock, 1u, __ATOMIC_ACQUIRE))
+		{
+			if (cache.count == PoolCacheSize)
+			{
+				// Hand the older half over, the recently freed half is the warmer one
+				PushFreeIndices(cache.indices, PoolCacheSize / 2);
+				MemoryCopy(cache.indices, cache.indices + PoolCacheSize / 2, sizeof(uint32) * (PoolCacheSize / 2));
+				cache.count = PoolCacheSize / 2;
+			}
+
+			cache.indices[cache.count++] = index;
+
+			__atomic_store_n(&cache.lock, 0u, __ATOMIC_RELEASE);
+		}
+		else
+		{
+			PushFreeIndices(&index, 1);
+		}
+	}
+
+	template<typename Type>
+	uint32 TConcurrentPool<Type>::GetHandle(Type* item)
+	{
+		size_t index = static_cast<size_t>(item - items);
+		BK_ASSERT(index < __atomic_load_n(&count, __ATOMIC_RELAXED));
+
+		uint16 generation = __atomic_load_n(&generations[index], __ATOMIC_ACQUIRE);
+
+		return (static_cast<uint32>(generation) << 16) | static_cast<uint32>(index);
+	}
+
+	template<typename Type>
+	Type* TConcurrentPool<Type>::GetItem(uint32 handle)
+	{
+		// Slots that were never handed out still have generation 0, which no handle carries
+		uint32 index = handle & 0xFFFF;
+		uint32 generation = handle >> 16;
+
+		if (generation == 0 || index >= __atomic_load_n(&count, __ATOMIC_ACQUIRE) ||
+			__atomic_load_n(&generations[index], __ATOMIC_ACQUIRE) != generation)
+		{
+			return nullptr;
+		}
+
+		return items + index;
+	}
+
+	template<typename Type>
+	uint32 TConcurrentPool<Type>::PopFreeIndex()
+	{
+		uint64 head = __atomic_load_n(&freeHead, __ATOMIC_ACQUIRE);
+		uint64 newHead;
+
+		do
+		{
+			uint32 first = static_cast<uint32>(head);
+			if (first == 0)
+			{
+				return UINT32_MAX;
+			}
+
+			// May read a link that was changed after head was loaded, the tag then makes the CAS fail
+			uint64 next = __atomic_load_n(&nextFree[first - 1], __ATOMIC_RELAXED);
+			newHead = (((head >> 32) + 1) << 32) | next;
+		} while (!__atomic_compare_exchange_n(&freeHead, &head, newHead, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+		return static_cast<uint32>(head) - 1;
+	}
+
+	template<typename Type>
+	uint32 TConcurrentPool<Type>::StealCachedIndex()
+	{
+		for (uint32 cacheIdx = 0; cacheIdx < PoolCacheCount; ++cacheIdx)
+		{
+			PoolCache& cache = caches[cacheIdx];
+			if (__atomic_exchange_n(&cache.lock, 1u, __ATOMIC_ACQUIRE))
+			{
+				continue;
+			}
+
+			uint32 index = cache.count > 0 ? cache.indices[--cache.count] : UINT32_MAX;
+			__atomic_store_n(&cache.lock, 0u, __ATOMIC_RELEASE);
+
+			if (index != UINT32_MAX)
+			{
+				return index;
+			}
+		}
+
+		return UINT32_MAX;
+	}
+
+	template<typename Type>
+	void TConcurrentPool<Type>::PushFreeIndices(const uint32* indices, uint32 indexCount)
+	{
+		for (uint32 indexIdx = 0; indexIdx + 1 < indexCount; ++indexIdx)
+		{
+			__atomic_store_n(&nextFree[indices[indexIdx]], indices[indexIdx + 1] + 1, __ATOMIC_RELAXED);
+		}
+
+		uint32 last = indices[indexCount - 1];
+		uint64 head = __atomic_load_n(&freeHead, __ATOMIC_RELAXED);
+		uint64 newHead;
+
+		do
+		{
+			__atomic_store_n(&nextFree[last], static_cast<uint32>(head), __ATOMIC_RELAXED);
+			newHead = (((head >> 32) + 1) << 32) | (indices[0] + 1);
+		} while (!__atomic_compare_exchange_n(&freeHead, &head, newHead, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	}
 }
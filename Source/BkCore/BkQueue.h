@@ -0,0 +1,333 @@
+#pragma once
+
+#include "BkArena.h"
+#include "BkCore.h"
+#include "BkSpan.h"
+
+namespace Bk
+{
+	constexpr size_t QueueCacheLineSize = 64;
+
+	// Bounded multi-producer multi-consumer queue after Vyukov. Every cell carries a sequence number that says
+	// whether it's ready for the producer or the consumer at a given position, so neither side needs a lock
+	template<typename Type>
+	struct TMpmcQueue
+	{
+		struct Cell
+		{
+			size_t sequence;
+			Type item;
+		};
+
+		// Capacity must be a power of two of at least 2
+		void Initialize(Arena* arena, size_t capacity);
+
+		// Fail when the queue is full or empty. Batches claim as many consecutive cells as are ready with one CAS
+		bool Push(const Type& item);
+		bool Pop(Type& item);
+		size_t PushBatch(TSpan<Type> batch);
+		size_t PopBatch(TSpan<Type> batch);
+
+		Cell* cells;
+		size_t mask;
+		alignas(QueueCacheLineSize) size_t enqueuePosition;
+		alignas(QueueCacheLineSize) size_t dequeuePosition;
+	};
+
+	// Bounded single-producer single-consumer ring. Each side keeps a stale copy of the other's position and only
+	// rereads it when the ring looks full or empty, so positions rarely move between cores
+	template<typename Type>
+	struct TSpscRing
+	{
+		// Capacity must be a power of two
+		void Initialize(Arena* arena, size_t capacity);
+
+		// Only called from the producer thread
+		bool Push(const Type& item);
+		size_t PushBatch(TSpan<Type> batch);
+
+		// Only called from the consumer thread
+		bool Pop(Type& item);
+		size_t PopBatch(TSpan<Type> batch);
+
+		Type* items;
+		size_t mask;
+		alignas(QueueCacheLineSize) size_t head; // Next position to pop, written by the consumer
+		size_t cachedTail;
+		alignas(QueueCacheLineSize) size_t tail; // Next position to push, written by the producer
+		size_t cachedHead;
+	};
+}
+
+namespace Bk
+{
+	template<typename Type>
+	void TMpmcQueue<Type>::Initialize(Arena* arena, size_t capacity)
+	{
+		BK_ASSERT(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+
+		cells = arena->Push<Cell>(capacity);
+		mask = capacity - 1;
+		enqueuePosition = 0;
+		dequeuePosition = 0;
+
+		for (size_t cellIdx = 0; cellIdx < capacity; ++cellIdx)
+		{
+			cells[cellIdx].sequence = cellIdx;
+		}
+	}
+
+	template<typename Type>
+	bool TMpmcQueue<Type>::Push(const Type& item)
+	{
+		size_t position = __atomic_load_n(&enqueuePosition, __ATOMIC_RELAXED);
+		Cell* cell;
+
+		for (;;)
+		{
+			cell = &cells[position & mask];
+			size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+			intptr_t difference = static_cast<intptr_t>(sequence - position);
+
+			if (difference == 0)
+			{
+				if (__atomic_compare_exchange_n(&enqueuePosition, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				{
+					break;
+				}
+			}
+			else if (difference < 0)
+			{
+				// Cell still holds the item from a lap ago
+				return false;
+			}
+			else
+			{
+				position = __atomic_load_n(&enqueuePosition, __ATOMIC_RELAXED);
+			}
+		}
+
+		cell->item = item;
+		__atomic_store_n(&cell->sequence, position + 1, __ATOMIC_RELEASE);
+
+		return true;
+	}
+
+	template<typename Type>
+	bool TMpmcQueue<Type>::Pop(Type& item)
+	{
+		size_t position = __atomic_load_n(&dequeuePosition, __ATOMIC_RELAXED);
+		Cell* cell;
+
+		for (;;)
+		{
+			cell = &cells[position & mask];
+			size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+			intptr_t difference = static_cast<intptr_t>(sequence - (position + 1));
+
+			if (difference == 0)
+			{
+				if (__atomic_compare_exchange_n(&dequeuePosition, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				{
+					break;
+				}
+			}
+			else if (difference < 0)
+			{
+				// Cell hasn't been written yet
+				return false;
+			}
+			else
+			{
+				position = __atomic_load_n(&dequeuePosition, __ATOMIC_RELAXED);
+			}
+		}
+
+		item = cell->item;
+		__atomic_store_n(&cell->sequence, position + mask + 1, __ATOMIC_RELEASE);
+
+		return true;
+	}
+
+	template<typename Type>
+	size_t TMpmcQueue<Type>::PushBatch(TSpan<Type> batch)
+	{
+		size_t position = __atomic_load_n(&enqueuePosition, __ATOMIC_RELAXED);
+		size_t count;
+
+		for (;;)
+		{
+			// A cell seen free stays free until its position is claimed, so the ready prefix can't shrink under us
+			count = 0;
+			while (count < batch.length && __atomic_load_n(&cells[(position + count) & mask].sequence, __ATOMIC_ACQUIRE) == position + count)
+			{
+				count += 1;
+			}
+
+			if (count > 0)
+			{
+				if (__atomic_compare_exchange_n(&enqueuePosition, &position, position + count, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				{
+					break;
+				}
+			}
+			else if (batch.length == 0 || static_cast<intptr_t>(__atomic_load_n(&cells[position & mask].sequence, __ATOMIC_ACQUIRE) - position) < 0)
+			{
+				return 0;
+			}
+			else
+			{
+				position = __atomic_load_n(&enqueuePosition, __ATOMIC_RELAXED);
+			}
+		}
+
+		for (size_t itemIdx = 0; itemIdx < count; ++itemIdx)
+		{
+			Cell& cell = cells[(position + itemIdx) & mask];
+			cell.item = batch.data[itemIdx];
+			__atomic_store_n(&cell.sequence, position + itemIdx + 1, __ATOMIC_RELEASE);
+		}
+
+		return count;
+	}
+
+	template<typename Type>
+	size_t TMpmcQueue<Type>::PopBatch(TSpan<Type> batch)
+	{
+		size_t position = __atomic_load_n(&dequeuePosition, __ATOMIC_RELAXED);
+		size_t count;
+
+		for (;;)
+		{
+			count = 0;
+			while (count < batch.length && __atomic_load_n(&cells[(position + count) & mask].sequence, __ATOMIC_ACQUIRE) == position + count + 1)
+			{
+				count += 1;
+			}
+
+			if (count > 0)
+			{
+				if (__atomic_compare_exchange_n(&dequeuePosition, &position, position + count, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				{
+					break;
+				}
+			}
+			else if (batch.length == 0 || static_cast<intptr_t>(__atomic_load_n(&cells[position & mask].sequence, __ATOMIC_ACQUIRE) - (position + 1)) < 0)
+			{
+				return 0;
+			}
+			else
+			{
+				position = __atomic_load_n(&dequeuePosition, __ATOMIC_RELAXED);
+			}
+		}
+
+		for (size_t itemIdx = 0; itemIdx < count; ++itemIdx)
+		{
+			Cell& cell = cells[(position + itemIdx) & mask];
+			batch.data[itemIdx] = cell.item;
+			__atomic_store_n(&cell.sequence, position + itemIdx + mask + 1, __ATOMIC_RELEASE);
+		}
+
+		return count;
+	}
+
+	template<typename Type>
+	void TSpscRing<Type>::Initialize(Arena* arena, size_t capacity)
+	{
+		BK_ASSERT(capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+		items = arena->Push<Type>(capacity);
+		mask = capacity - 1;
+		head = 0;
+		cachedTail = 0;
+		tail = 0;
+		cachedHead = 0;
+	}
+
+	template<typename Type>
+	bool TSpscRing<Type>::Push(const Type& item)
+	{
+		size_t position = tail;
+
+		if (position - cachedHead > mask)
+		{
+			cachedHead = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+			if (position - cachedHead > mask)
+			{
+				return false;
+			}
+		}
+
+		items[position & mask] = item;
+		__atomic_store_n(&tail, position + 1, __ATOMIC_RELEASE);
+
+		return true;
+	}
+
+	template<typename Type>
+	size_t TSpscRing<Type>::PushBatch(TSpan<Type> batch)
+	{
+		size_t position = tail;
+		size_t freeCount = mask + 1 - (position - cachedHead);
+
+		if (freeCount < batch.length)
+		{
+			cachedHead = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+			freeCount = mask + 1 - (position - cachedHead);
+		}
+
+		size_t count = BK_MIN(freeCount, batch.length);
+		for (size_t itemIdx = 0; itemIdx < count; ++itemIdx)
+		{
+			items[(position + itemIdx) & mask] = batch.data[itemIdx];
+		}
+
+		__atomic_store_n(&tail, position + count, __ATOMIC_RELEASE);
+
+		return count;
+	}
+
+	template<typename Type>
+	bool TSpscRing<Type>::Pop(Type& item)
+	{
+		size_t position = head;
+
+		if (position == cachedTail)
+		{
+			cachedTail = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+			if (position == cachedTail)
+			{
+				return false;
+			}
+		}
+
+		item = items[position & mask];
+		__atomic_store_n(&head, position + 1, __ATOMIC_RELEASE);
+
+		return true;
+	}
+
+	template<typename Type>
+	size_t TSpscRing<Type>::PopBatch(TSpan<Type> batch)
+	{
+		size_t position = head;
+		size_t readyCount = cachedTail - position;
+
+		if (readyCount < batch.length)
+		{
+			cachedTail = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+			readyCount = cachedTail - position;
+		}
+
+		size_t count = BK_MIN(readyCount, batch.length);
+		for (size_t itemIdx = 0; itemIdx < count; ++itemIdx)
+		{
+			batch.data[itemIdx] = items[(position + itemIdx) & mask];
+		}
+
+		__atomic_store_n(&head, position + count, __ATOMIC_RELEASE);
+
+		return count;
+	}
+}
@@ -92,6 +92,8 @@ namespace Bk
 		uint64 loMask;
 		uint64 hiMask;
 	};
+
+	constexpr uint32 StringHash(String string);
 }
 
 namespace Bk
@@ -181,4 +183,17 @@ namespace Bk
 
 		return ((bit & isLo & loMask) | (bit & isHi & hiMask)) != 0;
 	}
+
+	constexpr uint32 StringHash(String string)
+	{
+		// 32-bit FNV-1a
+		uint32 hash = 0x811C9DC5u;
+		for (size_t idx = 0; idx < string.length; ++idx)
+		{
+			hash ^= static_cast<uint8>(string.data[idx]);
+			hash *= 0x01000193u;
+		}
+
+		return hash;
+	}
 }
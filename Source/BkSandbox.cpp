@@ -1,8 +1,16 @@
+#include "BkCore/BkArchive.cpp"
 #include "BkCore/BkArena.cpp"
+#include "BkCore/BkCompression.cpp"
 #include "BkCore/BkCore.cpp"
+#include "BkCore/BkDirectory.cpp"
 #include "BkCore/BkFile.cpp"
+#include "BkCore/BkFileQueue.cpp"
+#include "BkCore/BkFileStream.cpp"
+#include "BkCore/BkFileWatcher.cpp"
 #include "BkCore/BkGpu.cpp"
+#include "BkCore/BkJobs.cpp"
 #include "BkCore/BkJson.cpp"
+#include "BkCore/BkJsonCache.cpp"
 #include "BkCore/BkMemory.cpp"
 #include "BkCore/BkString.cpp"
 
@@ -203,6 +211,8 @@ void Update()
 
 int main(int argc, char** argv)
 {
+	state.arena.tag = MemoryTag::Sandbox;
+
 	GpuInitialize();
 
 	emscripten_set_main_loop(Update, 0, true);
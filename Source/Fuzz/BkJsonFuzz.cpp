@@ -0,0 +1,149 @@
+// libFuzzer entry point for ParseJson, checking that rejected input leaves nothing behind and accepted input produces a
+// well formed tree that stays accepted with trailing whitespace and rejected with trailing garbage. Built on its own,
+// outside the sandbox unity build, e.g.
+//
+//   clang++ -std=c++20 -g -O1 -fsanitize=fuzzer,address,undefined -ISource Source/Fuzz/BkJsonFuzz.cpp -o BkJsonFuzz
+//   ./BkJsonFuzz [corpusDir]
+
+#include "../BkCore/BkArena.cpp"
+#include "../BkCore/BkCore.cpp"
+#include "../BkCore/BkJson.cpp"
+#include "../BkCore/BkMemory.cpp"
+#include "../BkCore/BkString.cpp"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace Bk;
+
+static Arena fuzzArena = {};
+
+static bool IsWithin(String inner, String outer)
+{
+	return inner.data >= outer.data && inner.data + inner.length <= outer.data + outer.length;
+}
+
+// Walks the tree the same way the lookups do and returns the number of values in it
+static size_t CheckJsonValue(JsonValue* value, JsonValue* parent, bool isKey, String json)
+{
+	BK_ASSERTF(value->parent == parent, "Parent link doesn't match the enclosing value");
+	BK_ASSERTF(IsWithin(value->value, json), "Value text lies outside of the input");
+
+	switch (value->type)
+	{
+		case JsonType::Null:
+			BK_ASSERT(value->value == "null");
+			return 1;
+
+		case JsonType::Bool:
+			BK_ASSERT(value->value == (value->asBool ? "true" : "false"));
+			return 1;
+
+		case JsonType::Number:
+		{
+			double number = 0.0;
+			BK_ASSERT(value->value.Parse(number) && memcmp(&number, &value->asNumber, sizeof(number)) == 0);
+			return 1;
+		}
+
+		case JsonType::String:
+			BK_ASSERT(value->value.data > json.data && value->value.data[-1] == '"');
+			BK_ASSERT(value->value.data[value->value.length] == '"');
+			BK_ASSERTF(value->hash == (isKey ? StringHash(value->value) : 0), "Only object keys are hashed");
+			return 1;
+
+		case JsonType::Array:
+		case JsonType::Object:
+			break;
+	}
+
+	const bool isObject = value->type == JsonType::Object;
+
+	BK_ASSERT(value->value.length >= 2);
+	BK_ASSERT(value->value.data[0] == (isObject ? '{' : '['));
+	BK_ASSERT(value->value.data[value->value.length - 1] == (isObject ? '}' : ']'));
+	BK_ASSERTF(!isObject || value->children % 2 == 0, "Object has a key without a value");
+
+	size_t valueCount = 1;
+
+	JsonValue* child = value->children > 0 ? value + 1 : nullptr;
+	for (size_t childIdx = 0; childIdx < value->children; ++childIdx)
+	{
+		BK_ASSERTF(child, "Sibling chain is shorter than the child count");
+		BK_ASSERTF(!isObject || childIdx % 2 == 1 || child->type == JsonType::String, "Object key isn't a string");
+		BK_ASSERTF(IsWithin(child->value, value->value), "Child text lies outside of its parent");
+
+		valueCount += CheckJsonValue(child, value, isObject && childIdx % 2 == 0, json);
+		child = child->sibling;
+	}
+
+	BK_ASSERTF(!child, "Sibling chain is longer than the child count");
+	return valueCount;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	// One spare byte past the input for the whitespace and garbage suffixes
+	char* buffer = static_cast<char*>(malloc(size + 1));
+	memcpy(buffer, data, size);
+
+	String json(buffer, size);
+
+	// Keep the arena's first block alive across runs, resetting to an empty arena would map a fresh block every time
+	if (!fuzzArena.currentBlock)
+	{
+		fuzzArena.Push<uint8>();
+	}
+
+	ArenaMarker marker = fuzzArena.GetMarker();
+
+	JsonParseResult result = {};
+	JsonValue* root = ParseJson(fuzzArena, json, &result);
+
+	if (!root)
+	{
+		ArenaMarker failedMarker = fuzzArena.GetMarker();
+
+		BK_ASSERTF(result.error != JsonError::None, "Rejected input without an error");
+		BK_ASSERTF(result.offset <= size, "Error offset past the end of the input");
+		BK_ASSERT(result.line >= 1 && result.column >= 1);
+		BK_ASSERTF(failedMarker.block == marker.block && failedMarker.offset == marker.offset, "Rejected input kept arena memory");
+
+		// Trailing whitespace doesn't turn an error into a success
+		buffer[size] = ' ';
+		BK_ASSERT(!ParseJson(fuzzArena, String(buffer, size + 1)));
+	}
+	else
+	{
+		BK_ASSERTF(result.error == JsonError::None, "Accepted input with an error");
+		BK_ASSERTF(!root->parent && !root->sibling, "Root value has a parent or sibling");
+		CheckJsonValue(root, nullptr, false, json);
+
+		// The tree is released before reparsing, keep what the truncation check needs
+		const bool isTerminated = root->type == JsonType::Array || root->type == JsonType::Object || root->type == JsonType::String;
+		const size_t rootEnd = size_t(root->value.end() - buffer) + (root->type == JsonType::String ? 1 : 0);
+
+		fuzzArena.SetMarker(marker);
+
+		buffer[size] = ' ';
+		BK_ASSERTF(ParseJson(fuzzArena, String(buffer, size + 1)), "Trailing whitespace rejected");
+
+		fuzzArena.SetMarker(marker);
+
+		buffer[size] = 'x';
+		BK_ASSERT(!ParseJson(fuzzArena, String(buffer, size + 1), &result) && result.error == JsonError::TrailingCharacters);
+
+		// Cutting off the closing character of a container or string always leaves it unterminated
+		if (isTerminated)
+		{
+			fuzzArena.SetMarker(marker);
+			BK_ASSERT(!ParseJson(fuzzArena, json.Range(0, rootEnd - 1), &result) && result.error == JsonError::UnexpectedEnd);
+		}
+	}
+
+	fuzzArena.SetMarker(marker);
+	free(buffer);
+
+	return 0;
+}